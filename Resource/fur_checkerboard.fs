@@ -0,0 +1,111 @@
+#version 330 core
+// Checkerboard reconstruction of the fur albedo: the fur pass marched only every other 2x2 quad this frame. The
+// missing pixels take the last frame's result reprojected onto their surface, clamped to the nearest pixels of the
+// four marched neighbouring quads, or an edge-aware average of those where the history belongs to another surface.
+// Depth and normal are complete, every pixel writes them before leaving the fur pass.
+layout (location = 0) out vec4 historyAlbedo;
+// x: depth, y: 1 where the albedo holds a result
+layout (location = 1) out vec2 historyDepth;
+layout (location = 2) out vec2 historyNormal;
+in vec2 TexCoords;
+
+uniform sampler2D gDepth;
+uniform sampler2D gNormal;
+uniform sampler2D gAlbedoSpec;
+uniform sampler2D previousAlbedo;
+uniform sampler2D previousDepth;
+uniform sampler2D previousNormal;
+
+uniform mat4 inverseViewProjection;
+uniform mat4 previousViewProjection;
+uniform mat4 inversePreviousViewProjection;
+uniform vec3 viewPos;
+// the fur pass marched the quads with (x / 2 + y / 2 + checkerParity) even
+uniform int checkerParity;
+
+vec3 DecodeNormal(vec2 e)
+{
+    e = e * 2.0 - 1.0;
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = clamp(-n.z, 0.0, 1.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
+
+vec3 ReconstructPosition(mat4 inverseMatrix, vec2 uv, float depth)
+{
+    vec4 world = inverseMatrix * vec4(vec3(uv, depth) * 2.0 - 1.0, 1.0);
+    return world.xyz / world.w;
+}
+
+void main()
+{
+    ivec2 size = textureSize(gAlbedoSpec, 0);
+    ivec2 texel = ivec2(TexCoords * vec2(size));
+    float depth = texelFetch(gDepth, texel, 0).r;
+    vec2 encodedNormal = texelFetch(gNormal, texel, 0).rg;
+    historyNormal = encodedNormal;
+    historyDepth = vec2(depth, depth < 1.0 ? 1.0 : 0.0);
+    ivec2 quad = texel >> 1;
+    if (depth >= 1.0 || ((quad.x + quad.y + checkerParity) & 1) == 0)
+    {
+        historyAlbedo = texelFetch(gAlbedoSpec, texel, 0);
+        return;
+    }
+
+    // the four quads sharing an edge with this one were all marched this frame; each gives its pixel nearest to this one
+    vec3 position = ReconstructPosition(inverseViewProjection, TexCoords, depth);
+    vec3 normal = DecodeNormal(encodedNormal);
+    float tolerance = 0.02 * length(position - viewPos);
+    vec4 sum = vec4(0.0);
+    float weightSum = 0.0;
+    vec4 low = vec4(1.0);
+    vec4 high = vec4(0.0);
+    const ivec2 offsets[4] = ivec2[4](ivec2(-1, 0), ivec2(1, 0), ivec2(0, -1), ivec2(0, 1));
+    for (int i = 0; i < 4; ++i)
+    {
+        ivec2 neighbourQuad = (quad + offsets[i]) * 2;
+        ivec2 neighbour = clamp(texel, neighbourQuad, neighbourQuad + 1);
+        // clamping onto the screen would land in this quad, which holds no result
+        if (any(lessThan(neighbour, ivec2(0))) || any(greaterThanEqual(neighbour, size)))
+            continue;
+        float neighbourDepth = texelFetch(gDepth, neighbour, 0).r;
+        if (neighbourDepth >= 1.0)
+            continue;
+        vec3 neighbourPosition = ReconstructPosition(inverseViewProjection, (vec2(neighbour) + 0.5) / vec2(size), neighbourDepth);
+        vec3 neighbourNormal = DecodeNormal(texelFetch(gNormal, neighbour, 0).rg);
+        // neighbours across a silhouette or a fold get almost no weight
+        float weight = exp(-length(neighbourPosition - position) / tolerance) * pow(max(dot(neighbourNormal, normal), 0.0), 8.0) + 1e-4;
+        vec4 albedo = texelFetch(gAlbedoSpec, neighbour, 0);
+        sum += albedo * weight;
+        weightSum += weight;
+        low = min(low, albedo);
+        high = max(high, albedo);
+    }
+    vec4 spatial = weightSum > 0.0 ? sum / weightSum : vec4(0.0);
+    if (weightSum == 0.0)
+    {
+        low = vec4(0.0);
+        high = vec4(1.0);
+    }
+
+    // where this surface was last frame, when the other half of the pixels was marched
+    vec4 previousClip = previousViewProjection * vec4(position, 1.0);
+    vec2 previousUV = previousClip.xy / previousClip.w * 0.5 + 0.5;
+    historyAlbedo = spatial;
+    if (all(greaterThanEqual(previousUV, vec2(0.0))) && all(lessThanEqual(previousUV, vec2(1.0))))
+    {
+        vec2 stored = texture(previousDepth, previousUV).rg;
+        vec3 storedPosition = ReconstructPosition(inversePreviousViewProjection, previousUV, stored.x);
+        bool sameDepth = stored.y > 0.0 && length(storedPosition - position) < tolerance;
+        bool sameNormal = dot(DecodeNormal(texture(previousNormal, previousUV).rg), normal) > 0.9;
+        if (sameDepth && sameNormal)
+        {
+            // strands are finer than the neighbourhood, so the history is only clamped to it once things move;
+            // a still image keeps both marched halves exactly
+            vec4 previous = texture(previousAlbedo, previousUV);
+            float motion = clamp(length((previousUV - TexCoords) * vec2(size)), 0.0, 1.0);
+            historyAlbedo = mix(previous, clamp(previous, low, high), motion);
+        }
+    }
+}
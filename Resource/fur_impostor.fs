@@ -0,0 +1,90 @@
+#version 330 core
+layout (location = 0) out vec2 gNormal;
+layout (location = 1) out vec4 gAlbedoSpec;
+#ifdef STORE_TANGENT
+layout (location = 2) out vec2 gTangent;
+#endif
+in vec3 WorldPos;
+
+// atlas of the octahedral views baked by BakeImpostorAtlas: octahedral normal and tangent, fur color, depth
+uniform sampler2D impostorNormal;
+uniform sampler2D impostorAlbedo;
+uniform sampler2D impostorTangent;
+uniform sampler2D impostorDepth;
+uniform int impostorViews;
+uniform vec3 impostorCenter;
+uniform float impostorRadius;
+uniform mat4 view;
+uniform mat4 projection;
+uniform vec3 viewPos;
+
+vec2 EncodeNormal(vec3 n)
+{
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    vec2 wrapped = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    return (n.z >= 0.0 ? n.xy : wrapped) * 0.5 + 0.5;
+}
+
+vec3 DecodeNormal(vec2 e)
+{
+    e = e * 2.0 - 1.0;
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = clamp(-n.z, 0.0, 1.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
+
+void main()
+{
+    // the four baked views around the direction towards the eye, weighted bilinearly on the octahedral grid
+    float LastView = float(impostorViews - 1);
+    vec2 Grid = EncodeNormal(normalize(viewPos - impostorCenter)) * LastView;
+    vec2 Base = min(floor(Grid), vec2(LastView - 1.0));
+    vec2 f = Grid - Base;
+    vec3 RayDir = normalize(WorldPos - viewPos);
+
+    vec4 Albedo = vec4(0.0);
+    vec3 Normal = vec3(0.0);
+    vec3 Tangent = vec3(0.0);
+    vec3 Surface = vec3(0.0);
+    float Coverage = 0.0;
+    for (int i = 0; i < 4; ++i)
+    {
+        vec2 Offset = vec2(i & 1, i >> 1);
+        vec2 Cell = Base + Offset;
+        float Weight = (Offset.x == 1.0 ? f.x : 1.0 - f.x) * (Offset.y == 1.0 ? f.y : 1.0 - f.y);
+        // basis of the view, as GetImpostorViewMatrices builds it
+        vec3 ViewDir = DecodeNormal(Cell / LastView);
+        vec3 Up = abs(ViewDir.y) > 0.999 ? vec3(0.0, 0.0, 1.0) : vec3(0.0, 1.0, 0.0);
+        vec3 Right = normalize(cross(Up, ViewDir));
+        Up = cross(ViewDir, Right);
+        // where the eye ray crosses the view's image plane through the center
+        float Facing = dot(RayDir, ViewDir);
+        if (abs(Facing) < 1e-4)
+            continue;
+        vec3 PlanePos = viewPos + RayDir * (dot(impostorCenter - viewPos, ViewDir) / Facing);
+        vec2 CellUV = vec2(dot(PlanePos - impostorCenter, Right), dot(PlanePos - impostorCenter, Up)) / (2.0 * impostorRadius) + 0.5;
+        if (any(lessThan(CellUV, vec2(0.0))) || any(greaterThan(CellUV, vec2(1.0))))
+            continue;
+        vec2 AtlasUV = (Cell + CellUV) / float(impostorViews);
+        float Depth = texture(impostorDepth, AtlasUV).r;
+        if (Depth >= 1.0)
+            continue;
+        Albedo += texture(impostorAlbedo, AtlasUV) * Weight;
+        Normal += DecodeNormal(texture(impostorNormal, AtlasUV).rg) * Weight;
+        Tangent += DecodeNormal(texture(impostorTangent, AtlasUV).rg) * Weight;
+        Surface += (PlanePos + ViewDir * (impostorRadius - 2.0 * impostorRadius * Depth)) * Weight;
+        Coverage += Weight;
+    }
+    // the silhouette is where half of the blended views see the object
+    if (Coverage < 0.5)
+        discard;
+
+    gNormal = EncodeNormal(normalize(Normal));
+#ifdef STORE_TANGENT
+    gTangent = EncodeNormal(normalize(Tangent));
+#endif
+    gAlbedoSpec = Albedo / Coverage;
+    vec4 Clip = projection * view * vec4(Surface / Coverage, 1.0);
+    gl_FragDepth = Clip.z / Clip.w * 0.5 + 0.5;
+}
@@ -0,0 +1,24 @@
+#version 330 core
+layout (location = 0) in vec3 position;
+layout (location = 1) in vec2 texCoords;
+
+out vec3 WorldPos;
+
+uniform mat4 view;
+uniform mat4 projection;
+uniform vec3 impostorCenter;
+uniform float impostorRadius;
+uniform vec3 viewPos;
+
+void main()
+{
+    // camera-facing quad around the bounding sphere; the ray through each fragment is intersected with the baked
+    // views, so the quad only has to cover the object's silhouette from every direction
+    vec3 cameraRight = vec3(view[0][0], view[1][0], view[2][0]);
+    vec3 cameraUp = vec3(view[0][1], view[1][1], view[2][1]);
+    // the sphere's silhouette under perspective is a little wider than its radius in the plane of its center
+    float Distance = distance(viewPos, impostorCenter);
+    float Extent = impostorRadius * Distance / sqrt(max(Distance * Distance - impostorRadius * impostorRadius, 1e-6));
+    WorldPos = impostorCenter + (cameraRight * position.x + cameraUp * position.y) * Extent;
+    gl_Position = projection * view * vec4(WorldPos, 1.0f);
+}
@@ -0,0 +1,16 @@
+#version 330 core
+layout (location = 0) out vec2 gNormal;
+
+in vec3 Normal;
+
+vec2 EncodeNormal(vec3 n)
+{
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    vec2 wrapped = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    return (n.z >= 0.0 ? n.xy : wrapped) * 0.5 + 0.5;
+}
+
+void main()
+{    
+    gNormal = EncodeNormal(normalize(Normal));
+}
@@ -0,0 +1,38 @@
+#version 330 core
+layout (location = 0) in vec3 position;
+layout (location = 1) in vec3 normal;
+layout (location = 2) in vec2 texCoords;
+layout (location = 3) in vec3 tangent;
+layout (location = 4) in vec3 bitangent;
+#ifdef SKINNED
+layout (location = 5) in vec4 boneIndices;
+layout (location = 6) in vec4 boneWeights;
+
+layout (std140) uniform BonePalette
+{
+    mat4 bones[MAX_BONES];
+};
+#endif
+
+out vec3 Normal;
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+uniform mat3 normalMatrix;
+
+void main()
+{
+    vec4 localPos = vec4(position, 1.0f);
+    vec3 localNormal = normal;
+#ifdef SKINNED
+    mat4 skin = boneWeights.x * bones[int(boneIndices.x)]
+              + boneWeights.y * bones[int(boneIndices.y)]
+              + boneWeights.z * bones[int(boneIndices.z)]
+              + boneWeights.w * bones[int(boneIndices.w)];
+    localPos = skin * localPos;
+    localNormal = mat3(skin) * normal;
+#endif
+    gl_Position = projection * view * model * localPos;
+    Normal = normalMatrix * localNormal;
+}
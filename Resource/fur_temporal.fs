@@ -0,0 +1,91 @@
+#version 330 core
+// Temporal resolve of the fur albedo: every frame the fur pass marches an interleaved subset of the layers,
+// this pass blends it into the history reprojected from the previous frame
+layout (location = 0) out vec4 historyAlbedo;
+// x: depth, y: number of accumulated frames
+layout (location = 1) out vec2 historyDepth;
+layout (location = 2) out vec2 historyNormal;
+in vec2 TexCoords;
+
+uniform sampler2D gDepth;
+uniform sampler2D gNormal;
+uniform sampler2D gAlbedoSpec;
+uniform sampler2D previousAlbedo;
+uniform sampler2D previousDepth;
+uniform sampler2D previousNormal;
+
+uniform mat4 inverseViewProjection;
+uniform mat4 previousViewProjection;
+uniform mat4 inversePreviousViewProjection;
+uniform vec3 viewPos;
+// history length cap, the blend weight of the current frame never drops below 1 / maxHistory
+uniform int maxHistory;
+
+vec3 DecodeNormal(vec2 e)
+{
+    e = e * 2.0 - 1.0;
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = clamp(-n.z, 0.0, 1.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
+
+vec3 ReconstructPosition(mat4 inverseMatrix, vec2 uv, float depth)
+{
+    vec4 world = inverseMatrix * vec4(vec3(uv, depth) * 2.0 - 1.0, 1.0);
+    return world.xyz / world.w;
+}
+
+void main()
+{
+    float depth = texture(gDepth, TexCoords).r;
+    vec2 encodedNormal = texture(gNormal, TexCoords).rg;
+    vec4 current = texture(gAlbedoSpec, TexCoords);
+    historyNormal = encodedNormal;
+    if (depth >= 1.0)
+    {
+        historyAlbedo = current;
+        historyDepth = vec2(depth, 0.0);
+        return;
+    }
+
+    // where this surface was last frame
+    vec3 position = ReconstructPosition(inverseViewProjection, TexCoords, depth);
+    vec4 previousClip = previousViewProjection * vec4(position, 1.0);
+    vec2 previousUV = previousClip.xy / previousClip.w * 0.5 + 0.5;
+
+    float history = 0.0;
+    if (all(greaterThanEqual(previousUV, vec2(0.0))) && all(lessThanEqual(previousUV, vec2(1.0))))
+    {
+        vec2 stored = texture(previousDepth, previousUV).rg;
+        // reject history of another surface: disocclusions, or a different side of the fur
+        vec3 storedPosition = ReconstructPosition(inversePreviousViewProjection, previousUV, stored.x);
+        bool sameDepth = stored.x < 1.0 && length(storedPosition - position) < 0.02 * length(position - viewPos);
+        bool sameNormal = dot(DecodeNormal(texture(previousNormal, previousUV).rg), DecodeNormal(encodedNormal)) > 0.9;
+        if (sameDepth && sameNormal)
+            history = stored.y;
+    }
+
+    // clip the history to the color distribution of the current neighbourhood, so stale colors cannot ghost
+    vec4 m1 = vec4(0.0);
+    vec4 m2 = vec4(0.0);
+    ivec2 size = textureSize(gAlbedoSpec, 0);
+    ivec2 texel = ivec2(TexCoords * vec2(size));
+    for (int y = -1; y <= 1; ++y)
+    {
+        for (int x = -1; x <= 1; ++x)
+        {
+            vec4 neighbour = texelFetch(gAlbedoSpec, clamp(texel + ivec2(x, y), ivec2(0), size - 1), 0);
+            m1 += neighbour;
+            m2 += neighbour * neighbour;
+        }
+    }
+    m1 /= 9.0;
+    vec4 sigma = sqrt(max(m2 / 9.0 - m1 * m1, 0.0));
+    // the current frame only holds a subset of the layers, so the box is kept generous
+    vec4 previous = clamp(texture(previousAlbedo, previousUV), m1 - 1.5 * sigma, m1 + 1.5 * sigma);
+
+    float frames = min(history + 1.0, float(maxHistory));
+    historyAlbedo = mix(previous, current, 1.0 / frames);
+    historyDepth = vec2(depth, frames);
+}
@@ -0,0 +1,235 @@
+#version 430 core
+// Compute version of the reference fur march in g_buffer_fur.fs (FIXED_SAMPLE_COUNT), with the same SAMPLE_COUNT
+// permutation. Each work group marches a 16x16 pixel tile; the texels of texture_noise and texture_diffuse that the
+// tile's rays cross are loaded into shared memory, and the march filters from there instead of fetching the same
+// texels again for every pixel and layer.
+layout (local_size_x = 16, local_size_y = 16) in;
+
+layout (rgba8) uniform writeonly image2D gAlbedoSpec;
+
+// xy: TexCoords, zw: tangent-space parallax offset (UVOffset), written by the RAY_ATTRIBUTES raster pass
+uniform sampler2D furRays;
+uniform sampler2D rayDepth;
+uniform sampler2D texture_diffuse;
+uniform sampler2D texture_noise;
+
+const int ReferenceSampleCount = 64; // Layers the fur opacity is tuned for
+#ifdef SAMPLE_COUNT
+// fewer layers, chosen by the frame-time governor under load; each layer stands in for several reference ones
+const int SampleCount = SAMPLE_COUNT;
+#else
+const int SampleCount = ReferenceSampleCount; // Number of fur samples of the reference march
+#endif
+const float FurLength = 1.5f; // Length of the fur
+const float PatternParallax = 15.0 * 0.04 + 0.08;
+
+const int TILE = 16;
+// texels per side of each cache; 2 x 48 x 48 x 4 bytes stays well inside the 32 KB GL guarantees
+const int CACHE = 48;
+shared float noiseCache[CACHE * CACHE];
+shared uint diffuseCache[CACHE * CACHE];
+shared vec2 tileTexCoords[TILE * TILE];
+shared bool tileCovered[TILE * TILE];
+shared uint maxFootprint[2];
+shared uint maxSweep;
+shared uint activeRays;
+// texel bounds of the noise (0, 1) and diffuse (2, 3) caches
+shared int cacheMin[4];
+shared int cacheMax[4];
+
+int noiseLevel;
+int diffuseLevel;
+bool cached;
+
+vec2 PatternUV(vec2 TexCoords, vec2 UVOffset, float Layer)
+{
+    vec2 CurUVOffset = -UVOffset * Layer * FurLength;
+    return (TexCoords + 0.04 * CurUVOffset) * 15 + 0.08 * CurUVOffset;
+}
+
+vec2 DiffuseUV(vec2 TexCoords, vec2 UVOffset, float Layer)
+{
+    return TexCoords + 0.04 * (-UVOffset * Layer * FurLength);
+}
+
+void ExpandBounds(int cache, vec2 uv, ivec2 size)
+{
+    ivec2 texel = ivec2(floor(uv * vec2(size) - 0.5));
+    atomicMin(cacheMin[cache * 2], texel.x);
+    atomicMin(cacheMin[cache * 2 + 1], texel.y);
+    atomicMax(cacheMax[cache * 2], texel.x + 1);
+    atomicMax(cacheMax[cache * 2 + 1], texel.y + 1);
+}
+
+ivec2 CacheOrigin(int cache)
+{
+    return ivec2(cacheMin[cache * 2], cacheMin[cache * 2 + 1]);
+}
+
+ivec2 CacheExtent(int cache)
+{
+    return ivec2(cacheMax[cache * 2], cacheMax[cache * 2 + 1]) - CacheOrigin(cache) + 1;
+}
+
+// distance between texture coordinates that wrap around, so the seam of a mesh does not count as a jump
+float UVDistance(vec2 a, vec2 b)
+{
+    vec2 d = abs(a - b);
+    return length(min(d, 1.0 - d));
+}
+
+// % is undefined for negative operands in GLSL, so the wrap goes through floor; the half texel keeps the quotient
+// clear of integer boundaries
+ivec2 Wrap(ivec2 texel, ivec2 size)
+{
+    return texel - size * ivec2(floor((vec2(texel) + 0.5) / vec2(size)));
+}
+
+float SampleNoise(vec2 uv)
+{
+    if (!cached)
+        return textureLod(texture_noise, uv, float(noiseLevel)).r;
+    vec2 t = uv * vec2(textureSize(texture_noise, noiseLevel)) - 0.5 - vec2(CacheOrigin(0));
+    ivec2 i = clamp(ivec2(floor(t)), ivec2(0), ivec2(CACHE - 2));
+    vec2 f = clamp(t - vec2(i), 0.0, 1.0);
+    float a = mix(noiseCache[i.y * CACHE + i.x], noiseCache[i.y * CACHE + i.x + 1], f.x);
+    float b = mix(noiseCache[(i.y + 1) * CACHE + i.x], noiseCache[(i.y + 1) * CACHE + i.x + 1], f.x);
+    return mix(a, b, f.y);
+}
+
+vec4 SampleDiffuse(vec2 uv)
+{
+    if (!cached)
+        return textureLod(texture_diffuse, uv, float(diffuseLevel));
+    vec2 t = uv * vec2(textureSize(texture_diffuse, diffuseLevel)) - 0.5 - vec2(CacheOrigin(1));
+    ivec2 i = clamp(ivec2(floor(t)), ivec2(0), ivec2(CACHE - 2));
+    vec2 f = clamp(t - vec2(i), 0.0, 1.0);
+    vec4 a = mix(unpackUnorm4x8(diffuseCache[i.y * CACHE + i.x]), unpackUnorm4x8(diffuseCache[i.y * CACHE + i.x + 1]), f.x);
+    vec4 b = mix(unpackUnorm4x8(diffuseCache[(i.y + 1) * CACHE + i.x]), unpackUnorm4x8(diffuseCache[(i.y + 1) * CACHE + i.x + 1]), f.x);
+    return mix(a, b, f.y);
+}
+
+void main()
+{
+    ivec2 pixel = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 local = ivec2(gl_LocalInvocationID.xy);
+    uint index = gl_LocalInvocationIndex;
+    ivec2 raySize = textureSize(furRays, 0);
+    bool inside = all(lessThan(pixel, raySize));
+    ivec2 texel = min(pixel, raySize - 1);
+    vec4 ray = texelFetch(furRays, texel, 0);
+    bool covered = inside && texelFetch(rayDepth, texel, 0).r < 1.0;
+    vec2 TexCoords = ray.xy;
+    vec2 UVOffset = ray.zw;
+
+    if (index == 0)
+    {
+        maxFootprint[0] = maxFootprint[1] = 0u;
+        maxSweep = 0u;
+    }
+    tileTexCoords[index] = TexCoords;
+    tileCovered[index] = covered;
+    barrier();
+
+    // texture footprint of one pixel from the neighbouring rays, like the derivatives of a fragment quad
+    if (covered)
+    {
+        int nx = local.y * TILE + (local.x ^ 1);
+        int ny = (local.y ^ 1) * TILE + local.x;
+        float du = tileCovered[nx] ? UVDistance(tileTexCoords[nx], TexCoords) : 0.0;
+        float dv = tileCovered[ny] ? UVDistance(tileTexCoords[ny], TexCoords) : 0.0;
+        // neighbours on another surface must not blow up the footprint of the whole tile
+        float footprint = min(max(du, dv), 0.02);
+        atomicMax(maxFootprint[0], floatBitsToUint(footprint * 15 * float(textureSize(texture_noise, 0).x)));
+        atomicMax(maxFootprint[1], floatBitsToUint(footprint * float(textureSize(texture_diffuse, 0).x)));
+    }
+    barrier();
+
+    // one mip level per texture for the whole tile, coarse enough for its most minified pixel
+    noiseLevel = clamp(int(ceil(log2(max(uintBitsToFloat(maxFootprint[0]), 1.0)))), 0, textureQueryLevels(texture_noise) - 1);
+    diffuseLevel = clamp(int(ceil(log2(max(uintBitsToFloat(maxFootprint[1]), 1.0)))), 0, textureQueryLevels(texture_diffuse) - 1);
+    ivec2 noiseSize = textureSize(texture_noise, noiseLevel);
+    ivec2 diffuseSize = textureSize(texture_diffuse, diffuseLevel);
+    if (covered)
+    {
+        // texels the ray moves per layer
+        float sweep = length(UVOffset) * FurLength / float(SampleCount);
+        atomicMax(maxSweep, floatBitsToUint(max(PatternParallax * sweep * float(noiseSize.x), 0.04 * sweep * float(diffuseSize.x))));
+    }
+    barrier();
+
+    // The whole sweep of a ray spans hundreds of texels at grazing angles, but neighbouring rays stay close at
+    // equal layers. The march therefore runs in chunks of layers whose sweep takes up about half of the cache,
+    // the other half is left for the spread of the tile.
+    int ChunkLayers = clamp(int(float(CACHE / 2) / max(uintBitsToFloat(maxSweep), 1e-3)), 1, SampleCount + 1);
+    bool marching = covered;
+    vec4 ResultColor = vec4(0, 0, 0, 0);
+    for (int first = 0; first <= SampleCount; first += ChunkLayers)
+    {
+        int last = min(first + ChunkLayers - 1, SampleCount);
+        if (index == 0)
+        {
+            for (int b = 0; b < 4; ++b)
+            {
+                cacheMin[b] = 0x7fffffff;
+                cacheMax[b] = -0x7fffffff;
+            }
+            activeRays = 0u;
+        }
+        barrier();
+        if (marching)
+        {
+            // the march is linear in the layer, so the ends of the chunk bound all of its samples
+            float FirstLayer = float(SampleCount - first) / float(SampleCount);
+            float LastLayer = float(SampleCount - last) / float(SampleCount);
+            ExpandBounds(0, PatternUV(TexCoords, UVOffset, FirstLayer), noiseSize);
+            ExpandBounds(0, PatternUV(TexCoords, UVOffset, LastLayer), noiseSize);
+            ExpandBounds(1, DiffuseUV(TexCoords, UVOffset, FirstLayer), diffuseSize);
+            ExpandBounds(1, DiffuseUV(TexCoords, UVOffset, LastLayer), diffuseSize);
+            atomicAdd(activeRays, 1u);
+        }
+        barrier();
+        // every ray of the tile saturated
+        if (activeRays == 0u)
+            break;
+
+        // chunks whose footprint does not fit (tiles spanning silhouettes or seams) fall back to texture fetches
+        cached = all(lessThanEqual(CacheExtent(0), ivec2(CACHE))) && all(lessThanEqual(CacheExtent(1), ivec2(CACHE)));
+        if (cached)
+        {
+            for (int i = int(index); i < CACHE * CACHE; i += TILE * TILE)
+            {
+                ivec2 offset = ivec2(i % CACHE, i / CACHE);
+                noiseCache[i] = texelFetch(texture_noise, Wrap(CacheOrigin(0) + offset, noiseSize), noiseLevel).r;
+                diffuseCache[i] = packUnorm4x8(texelFetch(texture_diffuse, Wrap(CacheOrigin(1) + offset, diffuseSize), diffuseLevel));
+            }
+        }
+        barrier();
+
+        for (int i = first; marching && i <= last; ++i)
+        {
+            float CurLayer = float(SampleCount - i) / float(SampleCount);
+            float Alpha = SampleNoise(PatternUV(TexCoords, UVOffset, CurLayer));
+            float PatternMask = step(CurLayer * CurLayer, Alpha);
+            Alpha = (1 - CurLayer * CurLayer);
+#ifdef SAMPLE_COUNT
+            Alpha = 1.0 - pow(1.0 - Alpha, float(ReferenceSampleCount) / float(SampleCount));
+#endif
+
+            vec4 BaseColor = SampleDiffuse(DiffuseUV(TexCoords, UVOffset, CurLayer));
+            BaseColor.a *= Alpha;
+            BaseColor.rgb -= (pow(1.0 - CurLayer, 3)) * 0.04;
+
+            float Remain = (1. - ResultColor.a);
+            ResultColor += vec4(BaseColor.rgb * Remain * BaseColor.a, BaseColor.a) * PatternMask;
+            ResultColor = clamp(ResultColor, 0, 1);
+            // no derivatives in compute, so saturated rays simply stop
+            marching = ResultColor.a <= 0.9999;
+        }
+        // the cache and the bounds are refilled by the next chunk
+        barrier();
+    }
+
+    if (inside)
+        imageStore(gAlbedoSpec, pixel, ResultColor);
+}
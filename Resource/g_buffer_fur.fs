@@ -1,7 +1,16 @@
 #version 330 core
-layout (location = 0) out vec3 gPosition;
-layout (location = 1) out vec3 gNormal;
-layout (location = 2) out vec4 gAlbedoSpec;
+// position is reconstructed from depth, normals are octahedral-encoded
+layout (location = 0) out vec2 gNormal;
+#ifdef RAY_ATTRIBUTES
+// TexCoords and UVOffset for the compute fur pass (g_buffer_fur.cs)
+layout (location = 1) out vec4 gRay;
+#else
+layout (location = 1) out vec4 gAlbedoSpec;
+#endif
+#ifdef STORE_TANGENT
+// surface tangent, the strand direction of the Kajiya-Kay lighting, octahedral-encoded like the normal
+layout (location = 2) out vec2 gTangent;
+#endif
 
 in vec2 TexCoords;
 in vec3 FragPos;
@@ -10,63 +19,358 @@ in mat3 TBN;
 
 uniform sampler2D texture_diffuse;
 uniform sampler2D texture_noise;
-uniform sampler2D texture_basePosition;
+uniform sampler2D texture_baseDepth;
 uniform vec3 viewPos;
 
-const int SampleCount = 64; // Number of fur samples
+#ifdef EDGE_DISSOLVE
+// signed distance to the silhouette of the base surface in screen heights, see jump_flood.fs: positive over
+// the skin, negative on the fringe of fur around it
+uniform sampler2D texture_edgeDistance;
+// size of this pass, to look the distance up at the pixel
+uniform vec2 furResolution;
+// distance over which strands thin out and fade towards the silhouette
+uniform float edgeDissolveWidth;
+#endif
+
+const int ReferenceSampleCount = 64; // Layers the fur opacity is tuned for
+#ifdef SAMPLE_COUNT
+// fewer layers, chosen by the frame-time governor under load; each layer stands in for several reference ones
+const int SampleCount = SAMPLE_COUNT;
+#else
+const int SampleCount = ReferenceSampleCount; // Number of fur samples of the reference march
+#endif
 const float FurLength = 1.5f; // Length of the fur
+// shift of the pattern UV per unit of CurUVOffset: 15 * 0.04 from the UV correction plus 0.08
+const float PatternParallax = 15.0 * 0.04 + 0.08;
+
+#ifdef HALF_PRECISION
+// Color accumulation, layer weights and UV offsets of the march in half precision. GLES drivers keep mediump
+// values in half-width registers. Absolute UVs stay 32-bit, 15x pattern tiling needs more than 10 mantissa bits.
+#define MEDIUMP mediump
+#else
+#define MEDIUMP
+#endif
+
+#ifdef EMULATE_FP16
+// Desktop GL ignores the qualifier, so the accuracy check (--compare-precision) also rounds every mediump result to
+// fp16 to reproduce the error there. Far slower than the plain march; never used for rendering.
+float Quantize(float x)
+{
+    uint bits = floatBitsToUint(x);
+    // round to nearest even at the 13 mantissa bits fp16 drops
+    bits = (bits + 0xFFFu + ((bits >> 13) & 1u)) & 0xFFFFE000u;
+    float h = uintBitsToFloat(bits);
+    // flush below the normal fp16 range, like mobile ALUs
+    return abs(h) < 6.103515625e-5 ? 0.0 : clamp(h, -65504.0, 65504.0);
+}
+vec2 Quantize(vec2 v)
+{
+    return vec2(Quantize(v.x), Quantize(v.y));
+}
+vec4 Quantize(vec4 v)
+{
+    return vec4(Quantize(v.x), Quantize(v.y), Quantize(v.z), Quantize(v.w));
+}
+#else
+#define Quantize(x) (x)
+#endif
+
+// adaptive march clamps, ignored by the FIXED_SAMPLE_COUNT reference permutation
+uniform int minSampleCount;
+uniform int maxSampleCount;
+
+#ifdef HIERARCHICAL_MARCH
+// dilated max-height pyramid of texture_noise, see BakeMaxHeightPyramid
+uniform sampler2D texture_maxHeight;
+uniform int maxHeightLevels;
+
+// Number of layers from layer index i on that cannot hit a strand. The ray moves StepTexels pattern texels
+// per layer and samples spread up to FilterTexels around it; while both stay within one cell of the start
+// cell, the dilated cell maximum bounds every height the march would read.
+int EmptyLayerRun(vec2 PatternUV, int i, int LayerCount, float StepTexels, float FilterTexels)
+{
+    for (int level = maxHeightLevels - 1; level > 0; --level)
+    {
+        float Reach = float(1 << level) - FilterTexels;
+        if (Reach <= 0.0)
+            break;
+        int Span = min(int(Reach / max(StepTexels, 1e-4)), LayerCount + 1 - i);
+        if (Span < 1)
+            continue;
+        // the threshold CurLayer^2 falls towards the skin, the last skipped layer has the lowest one
+        float EndLayer = float(LayerCount - (i + Span - 1)) / float(LayerCount);
+        ivec2 LevelSize = textureSize(texture_maxHeight, level);
+        ivec2 Cell = ivec2(floor(fract(PatternUV) * vec2(LevelSize)));
+        if (texelFetch(texture_maxHeight, min(Cell, LevelSize - 1), level).r < EndLayer * EndLayer)
+            return Span;
+    }
+    return 0;
+}
+#endif
+
+#ifdef CONE_STEP_MARCH
+// R: strand height, G: cone ratio / coneScale, see BakeConeStepMap
+uniform sampler2D texture_cone;
+uniform float coneScale;
+
+// Number of layers from layer index i on that stay inside the empty cone above the current texel. The ray moves
+// SweepTexels pattern texels per unit of layer; FilterTexels widens the ray by the filter footprint.
+int ConeLayerRun(vec2 PatternUV, int i, int LayerCount, float SweepTexels, float FilterTexels)
+{
+    float CurLayer = float(LayerCount - i) / float(LayerCount);
+    ivec2 Size = textureSize(texture_cone, 0);
+    vec2 Cone = texelFetch(texture_cone, min(ivec2(floor(fract(PatternUV) * vec2(Size))), Size - 1), 0).rg;
+    // height above the strand surface, in layers (a strand of height h reaches layer sqrt(h))
+    float Above = CurLayer - sqrt(Cone.r);
+    float Ratio = Cone.g * coneScale;
+    // largest descent that keeps the widened ray inside the cone: SweepTexels * d + FilterTexels <= Ratio * (Above - d)
+    float Descent = (Ratio * Above - FilterTexels) / (SweepTexels + Ratio);
+    if (Above <= 0.0 || Descent < 0.0)
+        return 0;
+    // the current layer and every layer within the descent are empty
+    return min(int(Descent * float(LayerCount)) + 1, LayerCount + 1 - i);
+}
+#endif
+
+#ifdef TEMPORAL_MARCH
+// every frame marches one of temporalStride interleaved subsets of the reference layers; layerJitter in [0, 1)
+// selects the subset and the temporal resolve pass accumulates them
+uniform int temporalStride;
+uniform float layerJitter;
+#endif
+
+#ifdef REFINED_MARCH
+// coarse layer count and bisection steps that locate the first strand crossing
+uniform int coarseSampleCount;
+uniform int refineSteps;
+
+// Pattern height under the ray at Layer, filtered like the layer loop does.
+float PatternHeight(float Layer, vec2 UVOffset, vec2 TexDx, vec2 TexDy, vec2 OffsetDx, vec2 OffsetDy)
+{
+    vec2 CurUVOffset = -UVOffset * Layer * FurLength;
+    vec2 CurPatternUV = (TexCoords + 0.04 * CurUVOffset) * 15 + 0.08 * CurUVOffset;
+    vec2 CurPatternDx = (TexDx - 0.04 * Layer * OffsetDx) * 15 - 0.08 * Layer * OffsetDx;
+    vec2 CurPatternDy = (TexDy - 0.04 * Layer * OffsetDy) * 15 - 0.08 * Layer * OffsetDy;
+    return textureGrad(texture_noise, CurPatternUV, CurPatternDx, CurPatternDy).r;
+}
+#endif
+
+#ifdef CHECKERBOARD
+// the march runs on the 2x2 pixel quads with (x / 2 + y / 2 + checkerParity) even, the others are reconstructed
+// afterwards. Skipping single pixels would leave two live lanes in every quad, and so the whole loop in every warp.
+uniform int checkerParity;
+#endif
 
+vec2 EncodeNormal(vec3 n)
+{
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    vec2 wrapped = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    return (n.z >= 0.0 ? n.xy : wrapped) * 0.5 + 0.5;
+}
+
+#ifdef DEPTH_ONLY
+// depth prepass permutation; the geometry pass then only shades fragments with GL_EQUAL depth
+void main()
+{
+}
+#elif defined(RAY_ATTRIBUTES)
+// ray setup of the compute fur pass, which marches from here
+void main()
+{
+    gNormal = EncodeNormal(normalize(Normal));
+#ifdef STORE_TANGENT
+    gTangent = EncodeNormal(TBN[0]);
+#endif
+    vec3 ViewDir = normalize(FragPos - viewPos);
+    gRay = vec4(TexCoords, FurLength * (TBN * ViewDir).xy);
+}
+#else
 void main()
 {    
-    // Store the fragment position vector in the first gbuffer texture
-    gPosition = FragPos;
-    gPosition = vec3(1);
-    // Also store the per-fragment normals into the gbuffer
-    gNormal = normalize(Normal);
+    // Store the per-fragment normals into the gbuffer
+    gNormal = EncodeNormal(normalize(Normal));
+#ifdef STORE_TANGENT
+    gTangent = EncodeNormal(TBN[0]);
+#endif
     // And the diffuse per-fragment color
 
-    vec4 ResultColor = vec4(0,0,0,0);
+    MEDIUMP vec4 ResultColor = vec4(0,0,0,0);
     float ShouldContinue = 1.0;
 
     vec3 ViewDir = normalize(FragPos - viewPos);
     vec3 TagenPixelToCamera = TBN * ViewDir;
     vec2 UVOffset = FurLength * TagenPixelToCamera.xy;
 
-    for(int i = 0; i < SampleCount + 1; ++i)
+    // Edge dissolve: near the silhouette only the taller strands remain (the pattern threshold rises) and they
+    // turn transparent, read once here instead of sampling the base surface every layer
+    float EdgeThinning = 0.0;
+    float EdgeOpacity = 1.0;
+#ifdef EDGE_DISSOLVE
+    float EdgeDistance = texture(texture_edgeDistance, gl_FragCoord.xy / furResolution).r;
+    float Edge = smoothstep(-edgeDissolveWidth, edgeDissolveWidth, EdgeDistance);
+    EdgeThinning = 0.5 * (1.0 - Edge);
+    EdgeOpacity = mix(0.3, 1.0, Edge);
+#endif
+
+#ifdef FIXED_SAMPLE_COUNT
+    int LayerCount = SampleCount;
+#ifdef SAMPLE_COUNT
+    float OpacityExponent = float(ReferenceSampleCount) / float(LayerCount);
+#endif
+#else
+    // One layer per pattern texel the parallax sweeps across, measured in pixels of screen footprint:
+    // views along the normal barely shift the pattern, and minified fur cannot resolve more layers than pixels
+    vec2 PatternSize = vec2(textureSize(texture_noise, 0));
+    float SweepTexels = PatternParallax * FurLength * length(UVOffset * PatternSize);
+    vec2 PatternDx = dFdx(TexCoords) * 15 * PatternSize;
+    vec2 PatternDy = dFdy(TexCoords) * 15 * PatternSize;
+    float FootprintTexels = max(1.0, max(length(PatternDx), length(PatternDy)));
+    int LayerCount = clamp(int(ceil(SweepTexels / FootprintTexels)), minSampleCount, maxSampleCount);
+#ifdef REFINED_MARCH
+    // the first crossing is refined by bisection, the layers below it only need to resolve the compositing
+    LayerCount = min(LayerCount, coarseSampleCount);
+#endif
+#ifdef TEMPORAL_MARCH
+    LayerCount = SampleCount / temporalStride;
+#endif
+    // each layer stands in for ReferenceSampleCount / LayerCount reference layers
+    float OpacityExponent = float(ReferenceSampleCount) / float(LayerCount);
+
+    // gradients are taken outside the loop, its trip count and exit differ between neighbouring pixels
+    vec2 TexDx = dFdx(TexCoords);
+    vec2 TexDy = dFdy(TexCoords);
+    vec2 OffsetDx = dFdx(UVOffset) * FurLength;
+    vec2 OffsetDy = dFdy(UVOffset) * FurLength;
+#endif
+#ifdef CHECKERBOARD
+    // half of the quads leave before the march; the gradients above are taken while the whole quad still runs
+    ivec2 Quad = ivec2(gl_FragCoord.xy) >> 1;
+    if (((Quad.x + Quad.y + checkerParity) & 1) != 0)
+    {
+        gAlbedoSpec = vec4(0.0);
+        return;
+    }
+#endif
+#ifdef HIERARCHICAL_MARCH
+    vec2 StepPattern = PatternParallax * FurLength * UVOffset * PatternSize / float(LayerCount);
+    float StepTexels = max(abs(StepPattern.x), abs(StepPattern.y));
+    // bilinear taps plus the coarser mip trilinear filtering may blend in
+    float FilterTexels = 2.0 * FootprintTexels;
+#endif
+#ifdef CONE_STEP_MARCH
+    // the baked cones already allow for bilinear taps at texel size, only minification widens the ray further
+    float ConeFilterTexels = 2.0 * (FootprintTexels - 1.0);
+#endif
+#ifdef REFINED_MARCH
+    // coarse march down to the first layer whose pattern mask passes, then bisect between it and the empty layer above;
+    // the compositing loop starts at the refined crossing, so silhouettes do not band with the coarse spacing
+    float FirstHitLayer = -1.0;
+    for (int i = 0; i < LayerCount + 1; ++i)
+    {
+        float CurLayer = float(LayerCount - i) / float(LayerCount);
+        if (PatternHeight(CurLayer, UVOffset, TexDx, TexDy, OffsetDx, OffsetDy) >= CurLayer * CurLayer)
+        {
+            FirstHitLayer = CurLayer;
+            break;
+        }
+    }
+    if (FirstHitLayer >= 0.0 && FirstHitLayer < 1.0)
+    {
+        float EmptyLayer = FirstHitLayer + 1.0 / float(LayerCount);
+        for (int k = 0; k < refineSteps; ++k)
+        {
+            float MidLayer = 0.5 * (FirstHitLayer + EmptyLayer);
+            if (PatternHeight(MidLayer, UVOffset, TexDx, TexDy, OffsetDx, OffsetDy) >= MidLayer * MidLayer)
+                FirstHitLayer = MidLayer;
+            else
+                EmptyLayer = MidLayer;
+        }
+    }
+#endif
+
+    for(int i = 0; i < LayerCount + 1; ++i)
     {
 
         // 计算Layer
-        float CurLayer = float(SampleCount - i)/float(SampleCount);
-        vec2 CurUVOffset = -UVOffset * CurLayer * FurLength;
+#ifdef REFINED_MARCH
+        float CurLayer = FirstHitLayer - float(i) / float(LayerCount);
+        if (CurLayer < 0.0)
+            break;
+#elif defined(TEMPORAL_MARCH)
+        // the skin layer is part of every subset
+        float CurLayer = max(float(LayerCount - i) - layerJitter, 0.0) / float(LayerCount);
+#else
+        float CurLayer = float(LayerCount - i)/float(LayerCount);
+#endif
+        MEDIUMP vec2 CurUVOffset = Quantize(-UVOffset * CurLayer * FurLength);
 
         // UV矫正
         vec2 CurUV = TexCoords + 0.04 * CurUVOffset ;
         vec2 PatternUV = CurUV * 15;
         vec2 CurPatternUV = PatternUV + 0.08 * CurUVOffset;
+#ifdef HIERARCHICAL_MARCH
+        int EmptyRun = EmptyLayerRun(CurPatternUV, i, LayerCount, StepTexels, FilterTexels);
+        if (EmptyRun > 0)
+        {
+            i += EmptyRun - 1;
+            continue;
+        }
+#endif
+#ifdef CONE_STEP_MARCH
+        // advance by the safe distance of the cone instead of a single layer
+        int ConeRun = ConeLayerRun(CurPatternUV, i, LayerCount, SweepTexels, ConeFilterTexels);
+        if (ConeRun > 0)
+        {
+            i += ConeRun - 1;
+            continue;
+        }
+#endif
 
         // FurPattern控制，当前Layer大于Pattern的采样值才计算贡献, 可用的函数: x, x^2, sqrt(x)....
-        float Alpha = texture(texture_noise, CurPatternUV).r;
-        float PatternMask =  step(CurLayer * CurLayer, Alpha);
+#ifdef FIXED_SAMPLE_COUNT
+        MEDIUMP float Alpha = Quantize(texture(texture_noise, CurPatternUV).r);
+#else
+        vec2 CurUVDx = TexDx - 0.04 * CurLayer * OffsetDx;
+        vec2 CurUVDy = TexDy - 0.04 * CurLayer * OffsetDy;
+        vec2 CurPatternDx = CurUVDx * 15 - 0.08 * CurLayer * OffsetDx;
+        vec2 CurPatternDy = CurUVDy * 15 - 0.08 * CurLayer * OffsetDy;
+        MEDIUMP float Alpha = Quantize(textureGrad(texture_noise, CurPatternUV, CurPatternDx, CurPatternDy).r);
+#endif
+        float PatternMask =  step(CurLayer * CurLayer + EdgeThinning, Alpha);
 
-        // todo: texture_basePosition
-        // 采样BasePosition以计算毛发边缘的镂空与透明效果
-        
         // 越靠外的毛发计算叠加颜色时的透明度越高，  可用的函数: 1-x, 1-x^2, 1-sqrt(x)...
-        Alpha = (1 - CurLayer * CurLayer);
+        Alpha = Quantize(1 - CurLayer * CurLayer);
 
         // 采样BaseColor
-        vec4 BaseColor =  texture(texture_diffuse, CurUV);
-        BaseColor.a *= Alpha;
+#ifdef FIXED_SAMPLE_COUNT
+        MEDIUMP vec4 BaseColor =  texture(texture_diffuse, CurUV);
+#ifdef SAMPLE_COUNT
+        Alpha = Quantize(1.0 - pow(1.0 - Alpha, OpacityExponent));
+#endif
+#else
+        MEDIUMP vec4 BaseColor =  textureGrad(texture_diffuse, CurUV, CurUVDx, CurUVDy);
+        Alpha = Quantize(1.0 - pow(1.0 - Alpha, OpacityExponent));
+#endif
+        BaseColor.a *= Alpha * EdgeOpacity;
         BaseColor.rgb -= (pow(1.0 - CurLayer, 3)) * 0.04;
+        BaseColor = Quantize(BaseColor);
 
         // 累计Color
-        float Remain = (1. - ResultColor.a);
+        MEDIUMP float Remain = (1. - ResultColor.a);
         ResultColor += vec4(BaseColor.rgb * Remain * BaseColor.a, BaseColor.a) * PatternMask  * ShouldContinue;
-        ResultColor = clamp(ResultColor, 0, 1);
+        ResultColor = Quantize(clamp(ResultColor, 0, 1));
         
         // ResultColor = 1.0时，结束叠加
+#ifdef FIXED_SAMPLE_COUNT
+        // the reference march stays in uniform control flow, so its implicit texture derivatives are unchanged
         ShouldContinue *= step(ResultColor.a, 0.9999);
+#else
+        // later layers would be multiplied by zero, so leaving is exact
+        if (ResultColor.a > 0.9999)
+            break;
+#endif
     }
 
     gAlbedoSpec = ResultColor;
-}
\ No newline at end of file
+}
+#endif
\ No newline at end of file
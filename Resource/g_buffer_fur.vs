@@ -4,29 +4,64 @@ layout (location = 1) in vec3 normal;
 layout (location = 2) in vec2 texCoords;
 layout (location = 3) in vec3 tangent;
 layout (location = 4) in vec3 bitangent;
+#ifdef SKINNED
+layout (location = 5) in vec4 boneIndices;
+layout (location = 6) in vec4 boneWeights;
+
+layout (std140) uniform BonePalette
+{
+    mat4 bones[MAX_BONES];
+};
+#endif
 
 out vec3 FragPos;
 out vec2 TexCoords;
 out vec3 Normal;
 out mat3 TBN;
+// the depth prepass and the geometry pass must produce bit-identical depth for GL_EQUAL testing
+invariant gl_Position;
 
 uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
+// transpose(inverse(mat3(model))), computed once per draw on the CPU
+uniform mat3 normalMatrix;
 
 void main()
 {
-    vec4 worldPos = model * vec4(position, 1.0f);
+    vec4 localPos = vec4(position, 1.0f);
+    vec3 localNormal = normal;
+    vec3 localTangent = tangent;
+    vec3 localBitangent = bitangent;
+#ifdef SKINNED
+    mat4 skin = boneWeights.x * bones[int(boneIndices.x)]
+              + boneWeights.y * bones[int(boneIndices.y)]
+              + boneWeights.z * bones[int(boneIndices.z)]
+              + boneWeights.w * bones[int(boneIndices.w)];
+    // bones are rigid, so the blended upper 3x3 is used for the whole frame
+    mat3 skin3 = mat3(skin);
+    localPos = skin * localPos;
+    localNormal = skin3 * normal;
+    localTangent = skin3 * tangent;
+    localBitangent = skin3 * bitangent;
+#endif
+
+    vec4 worldPos = model * localPos;
     FragPos = worldPos.xyz; 
     gl_Position = projection * view * worldPos;
     TexCoords = texCoords;
     
-    mat3 normalMatrix = transpose(inverse(mat3(model)));
-    Normal = normalMatrix * normal;
+    Normal = normalMatrix * localNormal;
 
-    vec3 T = normalize(normalMatrix * tangent);
-    vec3 B = normalize(normalMatrix * bitangent);
+    vec3 T = normalize(normalMatrix * localTangent);
+    vec3 B = normalize(normalMatrix * localBitangent);
     vec3 N = normalize(Normal);    
+#ifdef SKINNED
+    // blending several bones skews the frame slightly; Gram-Schmidt makes it orthonormal again for the fur march
+    // (it stays the blended frame, not the rest-pose one)
+    T = normalize(T - dot(T, N) * N);
+    B = sign(dot(cross(N, T), B)) * cross(N, T);
+#endif
     
     TBN = mat3(T, B, N);  
-}
\ No newline at end of file
+}
@@ -1,9 +1,6 @@
 #version 330 core
-layout (location = 0) out vec3 gPosition;
-
-in vec3 FragPos;
+// depth only, the base position is reconstructed from depth where needed
 
 void main()
 {    
-    gPosition = FragPos;
-}
\ No newline at end of file
+}
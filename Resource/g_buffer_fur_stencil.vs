@@ -4,8 +4,15 @@ layout (location = 1) in vec3 normal;
 layout (location = 2) in vec2 texCoords;
 layout (location = 3) in vec3 tangent;
 layout (location = 4) in vec3 bitangent;
+#ifdef SKINNED
+layout (location = 5) in vec4 boneIndices;
+layout (location = 6) in vec4 boneWeights;
 
-out vec3 FragPos;
+layout (std140) uniform BonePalette
+{
+    mat4 bones[MAX_BONES];
+};
+#endif
 
 uniform mat4 model;
 uniform mat4 view;
@@ -13,7 +20,13 @@ uniform mat4 projection;
 
 void main()
 {
-    vec4 worldPos = model * vec4(position, 1.0f);
-    FragPos = worldPos.xyz; 
-    gl_Position = projection * view * worldPos;
-}
\ No newline at end of file
+    vec4 localPos = vec4(position, 1.0f);
+#ifdef SKINNED
+    mat4 skin = boneWeights.x * bones[int(boneIndices.x)]
+              + boneWeights.y * bones[int(boneIndices.y)]
+              + boneWeights.z * bones[int(boneIndices.z)]
+              + boneWeights.w * bones[int(boneIndices.w)];
+    localPos = skin * localPos;
+#endif
+    gl_Position = projection * view * model * localPos;
+}
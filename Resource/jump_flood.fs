@@ -0,0 +1,58 @@
+#version 330 core
+// Jump flooding over the base pass depth: SEED marks the silhouette pixels of the base surface, every step pass
+// lets each pixel adopt the nearest seed found stepSize pixels away, and RESOLVE turns the seeds into a signed
+// distance to the silhouette that the fur pass reads once per pixel
+#ifdef RESOLVE
+out float edgeDistance;
+#else
+out ivec2 nearestSeed;
+#endif
+in vec2 TexCoords;
+
+uniform sampler2D baseDepth;
+uniform isampler2D seeds;
+uniform int stepSize;
+// converts base pass pixels into the distance unit, screen heights
+uniform float distanceScale;
+
+bool Covered(ivec2 p)
+{
+    ivec2 size = textureSize(baseDepth, 0);
+    return texelFetch(baseDepth, clamp(p, ivec2(0), size - 1), 0).r < 1.0;
+}
+
+void main()
+{
+    ivec2 p = ivec2(gl_FragCoord.xy);
+#ifdef SEED
+    bool edge = Covered(p) && !(Covered(p + ivec2(1, 0)) && Covered(p - ivec2(1, 0)) && Covered(p + ivec2(0, 1)) && Covered(p - ivec2(0, 1)));
+    nearestSeed = edge ? p : ivec2(-1);
+#elif defined(RESOLVE)
+    ivec2 seed = texelFetch(seeds, p, 0).xy;
+    // pixels the flood did not reach are farther than anything the dissolve looks at
+    float distance = seed.x >= 0 ? length(vec2(seed - p)) * distanceScale : 1.0;
+    // positive over the base surface, negative on the fur fringe around it
+    edgeDistance = Covered(p) ? distance : -distance;
+#else
+    ivec2 size = textureSize(seeds, 0);
+    ivec2 best = ivec2(-1);
+    float bestDistance = 1e20;
+    for (int y = -1; y <= 1; ++y)
+    {
+        for (int x = -1; x <= 1; ++x)
+        {
+            ivec2 q = p + ivec2(x, y) * stepSize;
+            if (any(lessThan(q, ivec2(0))) || any(greaterThanEqual(q, size)))
+                continue;
+            ivec2 seed = texelFetch(seeds, q, 0).xy;
+            vec2 offset = vec2(seed - p);
+            if (seed.x >= 0 && dot(offset, offset) < bestDistance)
+            {
+                best = seed;
+                bestDistance = dot(offset, offset);
+            }
+        }
+    }
+    nearestSeed = best;
+#endif
+}
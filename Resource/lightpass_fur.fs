@@ -2,33 +2,184 @@
 out vec4 FragColor;
 in vec2 TexCoords;
 
-uniform sampler2D gPosition;
+// depth at the resolution of this pass, used to reconstruct the position
+uniform sampler2D gDepth;
+// octahedral-encoded normal
 uniform sampler2D gNormal;
 uniform sampler2D gAlbedoSpec;
 
 uniform vec3 lightPos;
 uniform vec3 viewPos;
+uniform mat4 inverseViewProjection;
+
+vec3 DecodeNormal(vec2 e)
+{
+    e = e * 2.0 - 1.0;
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = clamp(-n.z, 0.0, 1.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
+
+vec3 ReconstructPosition(vec2 uv, float depth)
+{
+    vec4 world = inverseViewProjection * vec4(vec3(uv, depth) * 2.0 - 1.0, 1.0);
+    return world.xyz / world.w;
+}
+
+#ifdef UPSAMPLE
+// The gBuffer was rendered at reduced resolution; a full-resolution depth/normal prepass guides a
+// joint bilateral upsample of it.
+uniform sampler2D gDepthLow;
+uniform sampler2D gNormalFull;
+uniform vec2 lowResolution;
+uniform mat4 projection;
+
+float LinearDepth(float depth)
+{
+    return projection[3][2] / (projection[2][2] + depth * 2.0 - 1.0);
+}
+
+vec4 UpsampleAlbedo(vec2 uv, float depth, vec3 normal)
+{
+    vec2 lowPos = uv * lowResolution - 0.5;
+    vec2 base = floor(lowPos);
+    vec2 f = lowPos - base;
+    float z = LinearDepth(depth);
+
+    vec4 sum = vec4(0.0);
+    float weightSum = 0.0;
+    for (int i = 0; i < 4; ++i)
+    {
+        ivec2 offset = ivec2(i & 1, i >> 1);
+        ivec2 texel = clamp(ivec2(base) + offset, ivec2(0), ivec2(lowResolution) - 1);
+        float bilinear = (offset.x == 1 ? f.x : 1.0 - f.x) * (offset.y == 1 ? f.y : 1.0 - f.y);
+        float sampleDepth = texelFetch(gDepthLow, texel, 0).r;
+        // samples on another surface (or the background) get almost no weight
+        float depthWeight = sampleDepth < 1.0 ? exp(-abs(LinearDepth(sampleDepth) - z) / (0.02 * z)) : 0.0;
+        float normalWeight = pow(max(dot(DecodeNormal(texelFetch(gNormal, texel, 0).rg), normal), 0.0), 8.0);
+        float weight = bilinear * depthWeight * normalWeight + 1e-4 * bilinear;
+        sum += texelFetch(gAlbedoSpec, texel, 0) * weight;
+        weightSum += weight;
+    }
+    return sum / weightSum;
+}
+#endif
+
+#ifdef KAJIYA_KAY
+// strand tangent, octahedral-encoded
+uniform sampler2D gTangent;
+// strand terms indexed by (T.L, T.E) * 0.5 + 0.5, see BakeKajiyaKayLut
+// R: sin(T, L), G: primary highlight, B: secondary highlight
+uniform sampler2D kajiyaKayLut;
+// the highlights shift along the strand as its cuticle scales tilt the surface
+const float PrimaryShift = 0.15;
+const float SecondaryShift = -0.1;
+const vec3 PrimaryColor = vec3(0.12);
+const float SecondaryStrength = 0.25;
+
+// Kajiya-Kay strand lighting of one light, two lookups replace the sqrt and pow terms.
+vec3 StrandLighting(vec3 normal, vec3 tangent, vec3 lightDir, vec3 viewDir, vec3 albedo)
+{
+    vec3 primaryTangent = normalize(tangent + PrimaryShift * normal);
+    vec3 secondaryTangent = normalize(tangent + SecondaryShift * normal);
+    vec3 primary = texture(kajiyaKayLut, vec2(dot(primaryTangent, lightDir), dot(primaryTangent, viewDir)) * 0.5 + 0.5).rgb;
+    float secondary = texture(kajiyaKayLut, vec2(dot(secondaryTangent, lightDir), dot(secondaryTangent, viewDir)) * 0.5 + 0.5).b;
+    // strands on the side of the fur turned away from the light are shadowed by the fur in front of them
+    float shadow = clamp(dot(normal, lightDir) * 0.75 + 0.25, 0.0, 1.0);
+    return (primary.r * albedo + primary.g * PrimaryColor + secondary * SecondaryStrength * albedo) * shadow;
+}
+#endif
+
+// Direct light from lightDir, Kajiya-Kay on strands or Lambert.
+vec3 SurfaceLighting(vec3 normal, vec3 tangent, vec3 lightDir, vec3 viewDir, vec3 albedo)
+{
+#ifdef KAJIYA_KAY
+    return StrandLighting(normal, tangent, lightDir, viewDir, albedo);
+#else
+    return max(dot(normal, lightDir), 0.0) * albedo;
+#endif
+}
+
+#ifdef CLUSTERED_LIGHTS
+// froxel grid, must match light_clusters.h
+const int CLUSTER_TILES_X = 16;
+const int CLUSTER_TILES_Y = 9;
+const int CLUSTER_SLICES = 24;
+// two texels per light: position + radius, color
+uniform samplerBuffer clusterLights;
+// first index and light count of every cluster
+uniform usamplerBuffer clusterRecords;
+uniform usamplerBuffer clusterIndices;
+// slice = log(view depth) * sliceScale + sliceBias
+uniform float sliceScale;
+uniform float sliceBias;
+uniform mat4 view;
+
+// Sum of the point lights of the pixel's cluster; the CPU only lists lights whose range touches the cluster.
+vec3 ClusteredLighting(vec3 position, vec3 normal, vec3 tangent, vec3 viewDir, vec3 albedo)
+{
+    float viewDepth = -(view * vec4(position, 1.0)).z;
+    int slice = clamp(int(floor(log(viewDepth) * sliceScale + sliceBias)), 0, CLUSTER_SLICES - 1);
+    ivec2 tile = clamp(ivec2(TexCoords * vec2(CLUSTER_TILES_X, CLUSTER_TILES_Y)), ivec2(0), ivec2(CLUSTER_TILES_X - 1, CLUSTER_TILES_Y - 1));
+    uvec2 record = texelFetch(clusterRecords, (slice * CLUSTER_TILES_Y + tile.y) * CLUSTER_TILES_X + tile.x).rg;
+    vec3 result = vec3(0.0);
+    for (uint i = 0u; i < record.y; ++i)
+    {
+        int light = int(texelFetch(clusterIndices, int(record.x + i)).r);
+        vec4 positionRadius = texelFetch(clusterLights, light * 2);
+        vec3 color = texelFetch(clusterLights, light * 2 + 1).rgb;
+        vec3 toLight = positionRadius.xyz - position;
+        float distance2 = dot(toLight, toLight);
+        // smooth window reaching zero at the light's radius
+        float falloff = clamp(1.0 - distance2 / (positionRadius.w * positionRadius.w), 0.0, 1.0);
+        result += SurfaceLighting(normal, tangent, toLight * inversesqrt(max(distance2, 1e-8)), viewDir, albedo) * falloff * falloff * color;
+    }
+    return result;
+}
+#endif
 
 void main()
 {             
     // Retrieve data from gbuffer
-    vec3 FragPos = texture(gPosition, TexCoords).rgb;
-    vec3 Normal = texture(gNormal, TexCoords).rgb;
-    vec3 Diffuse = texture(gAlbedoSpec, TexCoords).rgb;
-    float Specular = texture(gAlbedoSpec, TexCoords).a;
+    float depth = texture(gDepth, TexCoords).r;
+    // background; the gBuffer colors are not cleared there
+    if (depth >= 1.0)
+    {
+        FragColor = vec4(0.0, 0.0, 0.0, 1.0);
+        return;
+    }
+#ifdef UPSAMPLE
+    vec3 Normal = DecodeNormal(texture(gNormalFull, TexCoords).rg);
+    vec4 AlbedoSpec = UpsampleAlbedo(TexCoords, depth, Normal);
+#else
+    vec3 Normal = DecodeNormal(texture(gNormal, TexCoords).rg);
+    vec4 AlbedoSpec = texture(gAlbedoSpec, TexCoords);
+#endif
+    vec3 FragPos = ReconstructPosition(TexCoords, depth);
+    vec3 Diffuse = AlbedoSpec.rgb;
+    float Specular = AlbedoSpec.a;
     
     // Then calculate lighting as usual
     vec3 lighting  = Diffuse * 0.1; // hard-coded ambient component
     vec3 viewDir  = normalize(viewPos - FragPos);
 
     vec3 lightDir = normalize(lightPos - FragPos);
-    vec3 diffuse = max(dot(Normal, lightDir), 0.0) * Diffuse;
+#ifdef KAJIYA_KAY
+    vec3 Tangent = DecodeNormal(texture(gTangent, TexCoords).rg);
+#else
+    vec3 Tangent = vec3(0.0);
+#endif
+    vec3 diffuse = SurfaceLighting(Normal, Tangent, lightDir, viewDir, Diffuse);
     // Specular
     vec3 halfwayDir = normalize(lightDir + viewDir);  
     float spec = pow(max(dot(Normal, halfwayDir), 0.0), 16.0);
     //vec3 specular = spec * Specular * Diffuse * 0.03;
 
     lighting = diffuse; //+ specular;
+#ifdef CLUSTERED_LIGHTS
+    lighting += ClusteredLighting(FragPos, Normal, Tangent, viewDir, Diffuse);
+#endif
     
     FragColor = vec4(lighting, 1.0);
-}
\ No newline at end of file
+}
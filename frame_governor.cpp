@@ -0,0 +1,70 @@
+#include "frame_governor.h"
+#include <algorithm>
+#include <utility>
+
+namespace
+{
+    // weight of a new result in the smoothed frame time
+    const double SMOOTHING = 0.1;
+    // consecutive results beyond a threshold before the level changes; the rise waits up to 16 times longer
+    const int DOWN_FRAMES = 15;
+    const int UP_FRAMES = 120;
+    const int MAX_UP_FRAMES = 16 * UP_FRAMES;
+    // timer results lag a few frames behind; the ones right after a change still measure the old level
+    const int SETTLE_FRAMES = 4;
+}
+
+FrameGovernor::FrameGovernor(std::vector<QualityLevel> levels, double targetMilliseconds, double downThreshold, double upThreshold)
+    : m_levels(std::move(levels)), m_targetMilliseconds(targetMilliseconds), m_downThreshold(downThreshold),
+      m_upThreshold(upThreshold), m_upWait(UP_FRAMES)
+{
+}
+
+bool FrameGovernor::Update(double gpuMilliseconds)
+{
+    if (++m_framesSinceChange <= SETTLE_FRAMES)
+        return false;
+    m_smoothedMilliseconds = m_hasResult ? m_smoothedMilliseconds + (gpuMilliseconds - m_smoothedMilliseconds) * SMOOTHING : gpuMilliseconds;
+    m_hasResult = true;
+    m_framesOver = m_smoothedMilliseconds > m_targetMilliseconds * m_downThreshold ? m_framesOver + 1 : 0;
+    m_framesUnder = m_smoothedMilliseconds < m_targetMilliseconds * m_upThreshold ? m_framesUnder + 1 : 0;
+
+    int level = m_level;
+    if (m_framesOver >= DOWN_FRAMES && m_level + 1 < (int)m_levels.size())
+    {
+        // undoing a rise that did not fit
+        if (m_lastChangeWasUp && m_framesSinceChange <= 2 * DOWN_FRAMES + UP_FRAMES / 4)
+            m_upWait = std::min(2 * m_upWait, MAX_UP_FRAMES);
+        ++level;
+    }
+    else if (m_framesUnder >= m_upWait && m_level > 0)
+    {
+        --level;
+    }
+    else
+    {
+        // a rise that held long enough makes the next one as quick as the first
+        if (m_lastChangeWasUp && m_framesSinceChange > 2 * DOWN_FRAMES + UP_FRAMES / 4)
+            m_upWait = UP_FRAMES;
+        return false;
+    }
+
+    m_lastChangeWasUp = level < m_level;
+    m_level = level;
+    m_framesOver = 0;
+    m_framesUnder = 0;
+    m_framesSinceChange = 0;
+    m_hasResult = false;
+    return true;
+}
+
+void FrameGovernor::Reset()
+{
+    m_level = 0;
+    m_hasResult = false;
+    m_framesOver = 0;
+    m_framesUnder = 0;
+    m_framesSinceChange = 0;
+    m_lastChangeWasUp = false;
+    m_upWait = UP_FRAMES;
+}
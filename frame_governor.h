@@ -0,0 +1,62 @@
+#pragma once
+#include <vector>
+
+// One step of the quality ladder: internal resolution relative to the framebuffer and layers of the fur march.
+struct QualityLevel
+{
+    float renderScale;
+    int furSampleCount;
+};
+
+// Holds the GPU time of a frame near a target by walking a ladder of quality levels, best first. Frame times are
+// smoothed, and the two thresholds form a hysteresis band: the level drops after the smoothed time has stayed
+// above target * downThreshold for a few results, and rises only after it has stayed below target * upThreshold
+// for much longer. A rise that has to be undone right away doubles the wait before the next one, so a level
+// that does not fit is not retried every few seconds.
+class FrameGovernor
+{
+private:
+    std::vector<QualityLevel> m_levels;
+    double m_targetMilliseconds;
+    double m_downThreshold;
+    double m_upThreshold;
+    int m_level = 0;
+    double m_smoothedMilliseconds = 0.0;
+    bool m_hasResult = false;
+    int m_framesOver = 0;
+    int m_framesUnder = 0;
+    int m_upWait;
+    // results since the last change, and whether that change was a rise
+    int m_framesSinceChange = 0;
+    bool m_lastChangeWasUp = false;
+
+public:
+    FrameGovernor(std::vector<QualityLevel> levels, double targetMilliseconds, double downThreshold = 0.95, double upThreshold = 0.7);
+
+    // feeds the GPU time of one frame; returns true when the level changed
+    bool Update(double gpuMilliseconds);
+    // back to the best level, e.g. after the governor was paused
+    void Reset();
+
+    const QualityLevel &GetQuality() const
+    {
+        return m_levels[m_level];
+    }
+    // 0 is the best level
+    int GetLevel() const
+    {
+        return m_level;
+    }
+    int GetLevelCount() const
+    {
+        return (int)m_levels.size();
+    }
+    double GetSmoothedMilliseconds() const
+    {
+        return m_smoothedMilliseconds;
+    }
+    double GetTargetMilliseconds() const
+    {
+        return m_targetMilliseconds;
+    }
+};
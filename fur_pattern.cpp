@@ -0,0 +1,204 @@
+#include "fur_pattern.h"
+#include "parallel.h"
+#include "stb_image.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FUR_PATTERN_SSE2
+#endif
+
+FurPattern LoadFurPattern(const char *file_path)
+{
+    FurPattern pattern;
+    int width, height, nrComponents;
+    unsigned char *data = stbi_load(file_path, &width, &height, &nrComponents, 0);
+    if (!data)
+    {
+        std::cout << "Fur pattern failed to load at path: " << file_path << std::endl;
+        return pattern;
+    }
+    pattern.width = width;
+    pattern.height = height;
+    pattern.heights.resize((size_t)width * height);
+    for (size_t i = 0; i < pattern.heights.size(); ++i)
+        pattern.heights[i] = data[i * nrComponents];
+    stbi_image_free(data);
+    return pattern;
+}
+
+GLuint BakeMaxHeightPyramid(const FurPattern &pattern, int levels)
+{
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    if (pattern.heights.empty())
+    {
+        // without a pattern nothing can be proven empty
+        const unsigned char full = 255;
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, 1, 1, 0, GL_RED, GL_UNSIGNED_BYTE, &full);
+        levels = 1;
+    }
+
+    std::vector<unsigned char> cells, dilated;
+    for (int level = 0; level < levels && !pattern.heights.empty(); ++level)
+    {
+        int cellSize = 1 << level;
+        int width = std::max(1, pattern.width >> level);
+        int height = std::max(1, pattern.height >> level);
+
+        // plain max over each cell, then over the 3x3 neighbourhood of cells (wrapping like the pattern)
+        cells.assign((size_t)width * height, 0);
+        ParallelFor(height, 8, [&](size_t begin, size_t end)
+                    {
+            for (size_t y = begin; y < end; ++y)
+            {
+                for (int x = 0; x < width; ++x)
+                {
+                    unsigned char value = 0;
+                    for (int sy = 0; sy < cellSize; ++sy)
+                        for (int sx = 0; sx < cellSize; ++sx)
+                            value = std::max(value, pattern.At(x * cellSize + sx, (int)y * cellSize + sy));
+                    cells[y * width + x] = value;
+                }
+            } });
+        dilated.assign(cells.size(), 0);
+        ParallelFor(height, 8, [&](size_t begin, size_t end)
+                    {
+            for (size_t y = begin; y < end; ++y)
+            {
+                for (int x = 0; x < width; ++x)
+                {
+                    unsigned char value = 0;
+                    for (int dy = -1; dy <= 1; ++dy)
+                    {
+                        int cy = ((int)y + dy + height) % height;
+                        for (int dx = -1; dx <= 1; ++dx)
+                            value = std::max(value, cells[cy * width + (x + dx + width) % width]);
+                    }
+                    dilated[y * width + x] = value;
+                }
+            } });
+        glTexImage2D(GL_TEXTURE_2D, level, GL_R8, width, height, 0, GL_RED, GL_UNSIGNED_BYTE, dilated.data());
+    }
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    return texture;
+}
+
+// Smallest squared cone ratio (distance / rise)^2 imposed by count consecutive texels of one row that are higher
+// than height; dx is the horizontal offset of the first texel, dy2 the squared row offset.
+static float RowMinConeRatio2(const float *row, int count, float dx, float dy2, float height, float best2)
+{
+    int i = 0;
+#ifdef FUR_PATTERN_SSE2
+    const __m128 vHeight = _mm_set1_ps(height);
+    const __m128 vDy2 = _mm_set1_ps(dy2);
+    const __m128 vMargin = _mm_set1_ps(CONE_DISTANCE_MARGIN);
+    const __m128 vZero = _mm_setzero_ps();
+    const __m128 vInf = _mm_set1_ps(std::numeric_limits<float>::infinity());
+    const __m128 vFour = _mm_set1_ps(4.0f);
+    __m128 vDx = _mm_setr_ps(dx, dx + 1.0f, dx + 2.0f, dx + 3.0f);
+    __m128 vBest = _mm_set1_ps(best2);
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 rise = _mm_sub_ps(_mm_loadu_ps(row + i), vHeight);
+        __m128 distance = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(vDx, vDx), vDy2));
+        distance = _mm_max_ps(_mm_sub_ps(distance, vMargin), vZero);
+        __m128 ratio2 = _mm_div_ps(_mm_mul_ps(distance, distance), _mm_mul_ps(rise, rise));
+        __m128 higher = _mm_cmpgt_ps(rise, vZero);
+        ratio2 = _mm_or_ps(_mm_and_ps(higher, ratio2), _mm_andnot_ps(higher, vInf));
+        vBest = _mm_min_ps(vBest, ratio2);
+        vDx = _mm_add_ps(vDx, vFour);
+    }
+    vBest = _mm_min_ps(vBest, _mm_shuffle_ps(vBest, vBest, _MM_SHUFFLE(1, 0, 3, 2)));
+    vBest = _mm_min_ps(vBest, _mm_shuffle_ps(vBest, vBest, _MM_SHUFFLE(2, 3, 0, 1)));
+    best2 = _mm_cvtss_f32(vBest);
+    dx += (float)i;
+#endif
+    for (; i < count; ++i, dx += 1.0f)
+    {
+        float rise = row[i] - height;
+        if (rise <= 0.0f)
+            continue;
+        float distance = std::max(std::sqrt(dx * dx + dy2) - CONE_DISTANCE_MARGIN, 0.0f);
+        best2 = std::min(best2, distance * distance / (rise * rise));
+    }
+    return best2;
+}
+
+ConeStepMap BakeConeStepMap(const FurPattern &pattern)
+{
+    ConeStepMap map;
+    int width = std::max(1, pattern.width);
+    int height = std::max(1, pattern.height);
+    // a cone wider than one tile of the pattern gains nothing
+    map.coneScale = (float)std::max(width, height);
+    std::vector<unsigned short> texels((size_t)width * height * 2, 65535);
+    if (!pattern.heights.empty())
+    {
+        auto start = std::chrono::steady_clock::now();
+        // heights in layers, every row stored twice so that wrapped row windows are contiguous
+        std::vector<float> rows((size_t)width * height * 2);
+        float maxLayer = 0.0f;
+        for (int y = 0; y < height; ++y)
+        {
+            for (int x = 0; x < width; ++x)
+            {
+                float layer = std::sqrt(pattern.heights[y * width + x] / 255.0f);
+                rows[(size_t)y * width * 2 + x] = rows[(size_t)y * width * 2 + x + width] = layer;
+                maxLayer = std::max(maxLayer, layer);
+            }
+        }
+
+        ParallelFor(height, 4, [&](size_t begin, size_t end)
+                    {
+            for (size_t y = begin; y < end; ++y)
+            {
+                for (int x = 0; x < width; ++x)
+                {
+                    float layer = rows[y * width * 2 + x];
+                    float maxRise = maxLayer - layer;
+                    float best2 = map.coneScale * map.coneScale;
+                    // rows in order of distance; stop once even the row offset alone cannot narrow the cone
+                    for (int k = 0; k <= height / 2 && maxRise > 0.0f; ++k)
+                    {
+                        float rowDistance = std::max((float)k - CONE_DISTANCE_MARGIN, 0.0f);
+                        if (rowDistance * rowDistance >= best2 * maxRise * maxRise)
+                            break;
+                        // columns that could still narrow the cone, at most one tile
+                        int reach = (int)std::ceil(std::sqrt(best2) * maxRise + CONE_DISTANCE_MARGIN);
+                        reach = std::min(reach, (width - 1) / 2);
+                        for (int dy : {k, -k})
+                        {
+                            const float *row = &rows[(size_t)((y + dy + height) % height) * width * 2];
+                            best2 = RowMinConeRatio2(row + (x - reach + width) % width, 2 * reach + 1, (float)-reach, (float)(k * k), layer, best2);
+                            if (k == 0)
+                                break;
+                        }
+                    }
+                    texels[(y * width + x) * 2] = (unsigned short)(pattern.heights[y * width + x] * 257);
+                    texels[(y * width + x) * 2 + 1] = (unsigned short)std::lround(std::sqrt(best2) / map.coneScale * 65535.0f);
+                }
+            } });
+        float ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "Cone step map " << width << "x" << height << " baked in " << ms << " ms" << std::endl;
+    }
+
+    glGenTextures(1, &map.texture);
+    glBindTexture(GL_TEXTURE_2D, map.texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16, width, height, 0, GL_RG, GL_UNSIGNED_SHORT, texels.data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    return map;
+}
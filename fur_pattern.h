@@ -0,0 +1,40 @@
+#pragma once
+#include "utils.h"
+
+// Strand heights of the fur pattern (red channel of the pattern texture), kept on the CPU to bake
+// acceleration structures for the fur march. The pattern tiles in both directions.
+struct FurPattern
+{
+    int width = 0;
+    int height = 0;
+    std::vector<unsigned char> heights;
+
+    unsigned char At(int x, int y) const
+    {
+        x = ((x % width) + width) % width;
+        y = ((y % height) + height) % height;
+        return heights[y * width + x];
+    }
+};
+
+// Returns an empty pattern when the image cannot be loaded.
+FurPattern LoadFurPattern(const char *file_path);
+
+// R8 texture with `levels` mip levels. Texel (x, y) of level L holds the maximum height of the 3x3 block of
+// 2^L x 2^L texel cells around cell (x, y), so it bounds every sample taken within one cell of that cell.
+GLuint BakeMaxHeightPyramid(const FurPattern &pattern, int levels);
+
+// Horizontal margin in texels taken off every cone: the march samples anywhere inside a texel and filters bilinearly.
+constexpr float CONE_DISTANCE_MARGIN = 1.5f;
+
+// Cone step map of the pattern: RG16 texture with the strand height in R and, in G, the widest cone above the
+// texel that no strand pierces, divided by coneScale. Heights are measured in layers (a strand of height h reaches
+// layer sqrt(h)), cone ratios in pattern texels per layer.
+struct ConeStepMap
+{
+    GLuint texture = 0;
+    float coneScale = 1.0f;
+};
+
+// Exhaustive search over the tiled pattern, rows in parallel on the worker pool and SIMD along each row.
+ConeStepMap BakeConeStepMap(const FurPattern &pattern);
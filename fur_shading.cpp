@@ -0,0 +1,38 @@
+#include "fur_shading.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cmath>
+
+GLuint BakeKajiyaKayLut(int size)
+{
+    std::vector<float> texels(size * size * 4);
+    ParallelFor(size, 8, [&](size_t begin, size_t end)
+                {
+        for (size_t y = begin; y < end; ++y)
+        {
+            // texel centers, so filtering between them stays within [-1, 1]
+            float cosEye = ((y + 0.5f) / size) * 2.0f - 1.0f;
+            float sinEye = std::sqrt(std::max(0.0f, 1.0f - cosEye * cosEye));
+            for (int x = 0; x < size; ++x)
+            {
+                float cosLight = ((x + 0.5f) / size) * 2.0f - 1.0f;
+                float sinLight = std::sqrt(std::max(0.0f, 1.0f - cosLight * cosLight));
+                float cone = std::max(sinLight * sinEye - cosLight * cosEye, 0.0f);
+                float *texel = &texels[(y * size + x) * 4];
+                texel[0] = sinLight;
+                texel[1] = std::pow(cone, KAJIYA_KAY_PRIMARY_EXPONENT);
+                texel[2] = std::pow(cone, KAJIYA_KAY_SECONDARY_EXPONENT);
+                texel[3] = 1.0f;
+            }
+        } });
+
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, size, size, 0, GL_RGBA, GL_FLOAT, texels.data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    return texture;
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include "utils.h"
+
+// Exponents of the two Kajiya-Kay highlights: the sharp primary one reflected off the strand surface and the
+// broader, tinted secondary one that passed through the strand.
+constexpr float KAJIYA_KAY_PRIMARY_EXPONENT = 80.0f;
+constexpr float KAJIYA_KAY_SECONDARY_EXPONENT = 12.0f;
+
+// Kajiya-Kay strand terms as a size x size RGBA16F texture indexed by (T.L, T.E) * 0.5 + 0.5, for unit strand
+// tangent T, light direction L and eye direction E:
+//   R: diffuse sin(T, L)
+//   G: primary highlight max(sin(T, L) sin(T, E) - (T.L)(T.E), 0)^KAJIYA_KAY_PRIMARY_EXPONENT
+//   B: secondary highlight, same with KAJIYA_KAY_SECONDARY_EXPONENT
+// The highlight term is the cosine of the angle between E and the cone of mirror directions around the strand.
+GLuint BakeKajiyaKayLut(int size = 128);
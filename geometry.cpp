@@ -0,0 +1,382 @@
+#include "geometry.h"
+#include "gl_ext.h"
+#include <algorithm>
+
+GeometryArena &GeometryArena::Instance()
+{
+    static GeometryArena arena;
+    return arena;
+}
+
+GLuint GeometryArena::GetVertexSize(VertexFormat format)
+{
+    switch (format)
+    {
+    case VertexFormat::Mesh:
+        return 3 + 3 + 2 + 3 + 3;
+    case VertexFormat::SkinnedMesh:
+        return 3 + 3 + 2 + 3 + 3 + 4 + 4;
+    case VertexFormat::Screen:
+        return 3 + 2;
+    default:
+        return 0;
+    }
+}
+
+void GeometryArena::SetupAttributes(VertexFormat format)
+{
+    Pool &pool = m_pools[(int)format];
+    glBindVertexArray(pool.vao);
+    glBindBuffer(GL_ARRAY_BUFFER, pool.vbo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, pool.ebo);
+    GLsizei stride = GetVertexSize(format) * sizeof(float);
+    if (format == VertexFormat::Mesh || format == VertexFormat::SkinnedMesh)
+    {
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void *)0);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void *)(3 * sizeof(float)));
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void *)(6 * sizeof(float)));
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, stride, (void *)(8 * sizeof(float)));
+        glEnableVertexAttribArray(4);
+        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, stride, (void *)(11 * sizeof(float)));
+        if (format == VertexFormat::SkinnedMesh)
+        {
+            glEnableVertexAttribArray(5);
+            glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, stride, (void *)(14 * sizeof(float)));
+            glEnableVertexAttribArray(6);
+            glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, stride, (void *)(18 * sizeof(float)));
+        }
+    }
+    else if (format == VertexFormat::Screen)
+    {
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void *)0);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (void *)(3 * sizeof(float)));
+    }
+    glBindVertexArray(0);
+}
+
+// Grows the buffers of a pool so that the given number of extra vertices/indices fit.
+// Existing contents are copied on the GPU, so handles allocated earlier stay valid.
+void GeometryArena::Reserve(VertexFormat format, GLuint vertexCount, GLuint indexCount)
+{
+    Pool &pool = m_pools[(int)format];
+    GLsizeiptr vertexBytes = GetVertexSize(format) * sizeof(float);
+    bool firstUse = pool.vao == 0;
+    bool changed = firstUse;
+    if (firstUse)
+    {
+        glGenVertexArrays(1, &pool.vao);
+    }
+
+    GLuint requiredVertices = pool.vertexCount + vertexCount;
+    if (firstUse || requiredVertices > pool.vertexCapacity)
+    {
+        GLuint capacity = std::max<GLuint>(std::max<GLuint>(pool.vertexCapacity * 2, 1 << 16), requiredVertices);
+        GLuint vbo;
+        glGenBuffers(1, &vbo);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, vbo);
+        glBufferData(GL_COPY_WRITE_BUFFER, capacity * vertexBytes, NULL, GL_STATIC_DRAW);
+        if (pool.vbo != 0)
+        {
+            glBindBuffer(GL_COPY_READ_BUFFER, pool.vbo);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, pool.vertexCount * vertexBytes);
+            glDeleteBuffers(1, &pool.vbo);
+        }
+        pool.vbo = vbo;
+        pool.vertexCapacity = capacity;
+        changed = true;
+    }
+
+    GLuint requiredIndices = pool.indexCount + indexCount;
+    if (firstUse || requiredIndices > pool.indexCapacity)
+    {
+        GLuint capacity = std::max<GLuint>(std::max<GLuint>(pool.indexCapacity * 2, 1 << 18), requiredIndices);
+        GLuint ebo;
+        glGenBuffers(1, &ebo);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, ebo);
+        glBufferData(GL_COPY_WRITE_BUFFER, capacity * sizeof(GLuint), NULL, GL_STATIC_DRAW);
+        if (pool.ebo != 0)
+        {
+            glBindBuffer(GL_COPY_READ_BUFFER, pool.ebo);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, pool.indexCount * sizeof(GLuint));
+            glDeleteBuffers(1, &pool.ebo);
+        }
+        pool.ebo = ebo;
+        pool.indexCapacity = capacity;
+        changed = true;
+    }
+
+    if (changed)
+        SetupAttributes(format);
+}
+
+MeshHandle GeometryArena::Allocate(VertexFormat format, GLenum mode, const std::vector<float> &vertices, const std::vector<GLuint> &indices)
+{
+    GLuint vertexSize = GetVertexSize(format);
+    GLuint vertexCount = static_cast<GLuint>(vertices.size() / vertexSize);
+    GLuint indexCount = static_cast<GLuint>(indices.size());
+    Reserve(format, vertexCount, indexCount);
+
+    Pool &pool = m_pools[(int)format];
+    MeshHandle mesh;
+    mesh.format = format;
+    mesh.mode = mode;
+    mesh.baseVertex = static_cast<GLint>(pool.vertexCount);
+    mesh.firstIndex = pool.indexCount;
+    mesh.indexCount = indexCount;
+
+    glBindBuffer(GL_ARRAY_BUFFER, pool.vbo);
+    glBufferSubData(GL_ARRAY_BUFFER, pool.vertexCount * vertexSize * sizeof(float), vertices.size() * sizeof(float), vertices.data());
+    glBindBuffer(GL_COPY_WRITE_BUFFER, pool.ebo);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, pool.indexCount * sizeof(GLuint), indices.size() * sizeof(GLuint), indices.data());
+    pool.vertexCount += vertexCount;
+    pool.indexCount += indexCount;
+    return mesh;
+}
+
+void GeometryArena::Bind(VertexFormat format)
+{
+    glBindVertexArray(m_pools[(int)format].vao);
+}
+
+void GeometryArena::Draw(const MeshHandle &mesh)
+{
+    Bind(mesh.format);
+    glDrawElementsBaseVertex(mesh.mode, mesh.indexCount, GL_UNSIGNED_INT, (void *)(mesh.firstIndex * sizeof(GLuint)), mesh.baseVertex);
+}
+
+void DrawList::Clear()
+{
+    for (auto &batch : m_batches)
+        batch.commands.clear();
+}
+
+void DrawList::Add(const MeshHandle &mesh, GLuint instanceCount)
+{
+    AddRange(mesh, 0, mesh.indexCount, instanceCount);
+}
+
+void DrawList::AddRange(const MeshHandle &mesh, GLuint firstIndex, GLuint indexCount, GLuint instanceCount)
+{
+    if (indexCount == 0 || instanceCount == 0)
+        return;
+    auto batch = std::find_if(m_batches.begin(), m_batches.end(), [&](const Batch &b)
+                              { return b.format == mesh.format && b.mode == mesh.mode; });
+    if (batch == m_batches.end())
+    {
+        m_batches.push_back({mesh.format, mesh.mode, {}});
+        batch = m_batches.end() - 1;
+    }
+    batch->commands.push_back({indexCount, instanceCount, mesh.firstIndex + firstIndex, mesh.baseVertex, 0});
+}
+
+void DrawList::Submit()
+{
+    GeometryArena &arena = GeometryArena::Instance();
+    bool indirect = GetGLCapabilities().multiDrawIndirect;
+    if (indirect)
+    {
+        size_t total = 0;
+        for (auto &batch : m_batches)
+            total += batch.commands.size();
+        GLsizeiptr bytes = total * sizeof(DrawElementsIndirectCommand);
+        if (m_indirectBuffer == 0)
+            glGenBuffers(1, &m_indirectBuffer);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_indirectBuffer);
+        if (bytes > m_indirectCapacity)
+        {
+            m_indirectCapacity = std::max<GLsizeiptr>(bytes, m_indirectCapacity * 2);
+            glBufferData(GL_DRAW_INDIRECT_BUFFER, m_indirectCapacity, NULL, GL_STREAM_DRAW);
+        }
+        GLsizeiptr offset = 0;
+        for (auto &batch : m_batches)
+        {
+            GLsizeiptr size = batch.commands.size() * sizeof(DrawElementsIndirectCommand);
+            if (size > 0)
+                glBufferSubData(GL_DRAW_INDIRECT_BUFFER, offset, size, batch.commands.data());
+            offset += size;
+        }
+    }
+
+    GLsizeiptr offset = 0;
+    for (auto &batch : m_batches)
+    {
+        if (batch.commands.empty())
+            continue;
+        arena.Bind(batch.format);
+        if (indirect)
+        {
+            glMultiDrawElementsIndirectExt(batch.mode, GL_UNSIGNED_INT, (void *)offset, (GLsizei)batch.commands.size(), 0);
+            offset += batch.commands.size() * sizeof(DrawElementsIndirectCommand);
+        }
+        else
+        {
+            for (const auto &cmd : batch.commands)
+            {
+                glDrawElementsInstancedBaseVertex(batch.mode, cmd.count, GL_UNSIGNED_INT, (void *)(cmd.firstIndex * sizeof(GLuint)), cmd.instanceCount, cmd.baseVertex);
+            }
+        }
+    }
+    if (indirect)
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+DrawList::~DrawList()
+{
+    if (m_indirectBuffer != 0)
+        glDeleteBuffers(1, &m_indirectBuffer);
+}
+
+void GenerateSphere(std::vector<float> &vertices, std::vector<GLuint> &indices, unsigned int segments)
+{
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec2> uv;
+    std::vector<glm::vec3> normals;
+    std::vector<glm::vec3> tangents, bitangents;
+
+    const unsigned int X_SEGMENTS = segments;
+    const unsigned int Y_SEGMENTS = segments;
+    const float PI = 3.14159265359f;
+    for (unsigned int x = 0; x <= X_SEGMENTS; ++x)
+    {
+        for (unsigned int y = 0; y <= Y_SEGMENTS; ++y)
+        {
+            float xSegment = (float)x / (float)X_SEGMENTS;
+            float ySegment = (float)y / (float)Y_SEGMENTS;
+            float xPos = std::cos(xSegment * 2.0f * PI) * std::sin(ySegment * PI);
+            float yPos = std::cos(ySegment * PI);
+            float zPos = std::sin(xSegment * 2.0f * PI) * std::sin(ySegment * PI);
+            float theta = xSegment * 2.0f * PI;
+            float phi = ySegment * PI;
+
+            glm::vec3 n(
+                std::cos(theta) * std::sin(phi),
+                std::cos(phi),
+                std::sin(theta) * std::sin(phi)
+            );
+            glm::vec3 t(
+                -std::sin(theta),
+                0.0f,
+                std::cos(theta)
+            );
+            glm::vec3 b(
+                std::cos(theta) * std::cos(phi),
+                -std::sin(phi),
+                std::sin(theta) * std::cos(phi)
+            );
+            tangents.push_back(glm::normalize(t));
+            bitangents.push_back(glm::normalize(b));
+
+            positions.push_back(glm::vec3(xPos, yPos, zPos));
+            uv.push_back(glm::vec2(xSegment, ySegment));
+            normals.push_back(glm::vec3(xPos, yPos, zPos));
+        }
+    }
+
+    indices.clear();
+    bool oddRow = false;
+    for (unsigned int y = 0; y < Y_SEGMENTS; ++y)
+    {
+        if (!oddRow) // even rows: y == 0, y == 2; and so on
+        {
+            for (unsigned int x = 0; x <= X_SEGMENTS; ++x)
+            {
+                indices.push_back(y * (X_SEGMENTS + 1) + x);
+                indices.push_back((y + 1) * (X_SEGMENTS + 1) + x);
+            }
+        }
+        else
+        {
+            for (int x = X_SEGMENTS; x >= 0; --x)
+            {
+                indices.push_back((y + 1) * (X_SEGMENTS + 1) + x);
+                indices.push_back(y * (X_SEGMENTS + 1) + x);
+            }
+        }
+        oddRow = !oddRow;
+    }
+
+    vertices.clear();
+    for (unsigned int i = 0; i < positions.size(); ++i)
+    {
+        vertices.push_back(positions[i].x);
+        vertices.push_back(positions[i].y);
+        vertices.push_back(positions[i].z);
+        vertices.push_back(normals[i].x);
+        vertices.push_back(normals[i].y);
+        vertices.push_back(normals[i].z);
+        vertices.push_back(uv[i].x);
+        vertices.push_back(uv[i].y);
+        vertices.push_back(tangents[i].x);
+        vertices.push_back(tangents[i].y);
+        vertices.push_back(tangents[i].z);
+        vertices.push_back(bitangents[i].x);
+        vertices.push_back(bitangents[i].y);
+        vertices.push_back(bitangents[i].z);
+    }
+}
+
+std::vector<GLuint> StripToTriangles(const std::vector<GLuint> &strip)
+{
+    std::vector<GLuint> triangles;
+    triangles.reserve(strip.size() * 3);
+    for (size_t i = 2; i < strip.size(); ++i)
+    {
+        GLuint a = strip[i - 2], b = strip[i - 1], c = strip[i];
+        if (a == b || b == c || a == c)
+            continue;
+        // every other triangle of a strip has flipped winding
+        if (i % 2 == 0)
+            triangles.insert(triangles.end(), {a, b, c});
+        else
+            triangles.insert(triangles.end(), {b, a, c});
+    }
+    return triangles;
+}
+
+const MeshHandle &GetSphereMesh()
+{
+    static MeshHandle sphere;
+    if (sphere.indexCount == 0)
+    {
+        std::vector<float> vertices;
+        std::vector<GLuint> indices;
+        GenerateSphere(vertices, indices);
+        sphere = GeometryArena::Instance().Allocate(VertexFormat::Mesh, GL_TRIANGLE_STRIP, vertices, indices);
+    }
+    return sphere;
+}
+
+const MeshHandle &GetQuadMesh()
+{
+    static MeshHandle quad;
+    if (quad.indexCount == 0)
+    {
+        std::vector<float> quadVertices = {
+            // positions        // texture Coords
+            -1.0f, 1.0f, 0.0f, 0.0f, 1.0f,
+            -1.0f, -1.0f, 0.0f, 0.0f, 0.0f,
+            1.0f, 1.0f, 0.0f, 1.0f, 1.0f,
+            1.0f, -1.0f, 0.0f, 1.0f, 0.0f,
+        };
+        std::vector<GLuint> quadIndices = {0, 1, 2, 3};
+        quad = GeometryArena::Instance().Allocate(VertexFormat::Screen, GL_TRIANGLE_STRIP, quadVertices, quadIndices);
+    }
+    return quad;
+}
+
+void RenderSphere()
+{
+    GeometryArena::Instance().Draw(GetSphereMesh());
+}
+
+void RenderQuad()
+{
+    GeometryArena::Instance().Draw(GetQuadMesh());
+    glBindVertexArray(0);
+}
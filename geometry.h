@@ -0,0 +1,99 @@
+#pragma once
+#include "utils.h"
+
+// Every vertex format owns one VAO whose vertex and index buffers are shared by all meshes of that format.
+enum class VertexFormat
+{
+    Mesh,        // position, normal, uv, tangent, bitangent
+    SkinnedMesh, // Mesh + 4 bone indices (stored as floats) + 4 bone weights
+    Screen,      // position, uv
+    Count
+};
+
+// A sub-allocation inside the geometry arena.
+struct MeshHandle
+{
+    VertexFormat format = VertexFormat::Mesh;
+    GLenum mode = GL_TRIANGLES;
+    GLint baseVertex = 0;
+    GLuint firstIndex = 0;
+    GLuint indexCount = 0;
+};
+
+// Same layout as the commands consumed by glMultiDrawElementsIndirect.
+struct DrawElementsIndirectCommand
+{
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+class GeometryArena
+{
+private:
+    struct Pool
+    {
+        GLuint vao = 0;
+        GLuint vbo = 0;
+        GLuint ebo = 0;
+        GLuint vertexCapacity = 0;
+        GLuint vertexCount = 0;
+        GLuint indexCapacity = 0;
+        GLuint indexCount = 0;
+    };
+    Pool m_pools[(int)VertexFormat::Count];
+
+    void Reserve(VertexFormat format, GLuint vertexCount, GLuint indexCount);
+    void SetupAttributes(VertexFormat format);
+
+public:
+    static GeometryArena &Instance();
+    // size in floats of one vertex
+    static GLuint GetVertexSize(VertexFormat format);
+
+    MeshHandle Allocate(VertexFormat format, GLenum mode, const std::vector<float> &vertices, const std::vector<GLuint> &indices);
+    void Bind(VertexFormat format);
+    void Draw(const MeshHandle &mesh);
+};
+
+// Collects draws of arena meshes and submits each (format, mode) group with a single
+// glMultiDrawElementsIndirect, or a loop of base-vertex draws on GL 3.3.
+class DrawList
+{
+private:
+    struct Batch
+    {
+        VertexFormat format;
+        GLenum mode;
+        std::vector<DrawElementsIndirectCommand> commands;
+    };
+    std::vector<Batch> m_batches;
+    GLuint m_indirectBuffer = 0;
+    GLsizeiptr m_indirectCapacity = 0;
+
+public:
+    void Clear();
+    void Add(const MeshHandle &mesh, GLuint instanceCount = 1);
+    // draws indices [firstIndex, firstIndex + indexCount) relative to the start of the mesh
+    void AddRange(const MeshHandle &mesh, GLuint firstIndex, GLuint indexCount, GLuint instanceCount = 1);
+    bool Empty() const
+    {
+        for (const auto &batch : m_batches)
+            if (!batch.commands.empty())
+                return false;
+        return true;
+    }
+    void Submit();
+    ~DrawList();
+};
+
+// unit sphere in the Mesh vertex format, indexed as one triangle strip
+void GenerateSphere(std::vector<float> &vertices, std::vector<GLuint> &indices, unsigned int segments = 64);
+std::vector<GLuint> StripToTriangles(const std::vector<GLuint> &strip);
+
+const MeshHandle &GetSphereMesh();
+const MeshHandle &GetQuadMesh();
+void RenderSphere();
+void RenderQuad();
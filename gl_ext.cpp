@@ -0,0 +1,67 @@
+#include "gl_ext.h"
+#include <GLFW/glfw3.h>
+#include <cstring>
+#include <iostream>
+
+PFN_glMultiDrawElementsIndirect glMultiDrawElementsIndirectExt = nullptr;
+PFN_glDispatchCompute glDispatchComputeExt = nullptr;
+PFN_glBindImageTexture glBindImageTextureExt = nullptr;
+PFN_glMemoryBarrier glMemoryBarrierExt = nullptr;
+PFN_glInvalidateFramebuffer glInvalidateFramebufferExt = nullptr;
+PFN_glInvalidateTexImage glInvalidateTexImageExt = nullptr;
+
+static GLCapabilities capabilities;
+
+static bool HasExtension(const char *name)
+{
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; ++i)
+    {
+        const char *ext = reinterpret_cast<const char *>(glGetStringi(GL_EXTENSIONS, i));
+        if (ext && std::strcmp(ext, name) == 0)
+            return true;
+    }
+    return false;
+}
+
+static bool VersionAtLeast(int major, int minor)
+{
+    return capabilities.major > major || (capabilities.major == major && capabilities.minor >= minor);
+}
+
+void LoadGLExtensions()
+{
+    glGetIntegerv(GL_MAJOR_VERSION, &capabilities.major);
+    glGetIntegerv(GL_MINOR_VERSION, &capabilities.minor);
+
+    if (VersionAtLeast(4, 3) || HasExtension("GL_ARB_multi_draw_indirect"))
+    {
+        glMultiDrawElementsIndirectExt = (PFN_glMultiDrawElementsIndirect)glfwGetProcAddress("glMultiDrawElementsIndirect");
+    }
+    capabilities.multiDrawIndirect = glMultiDrawElementsIndirectExt != nullptr;
+
+    if (VersionAtLeast(4, 3))
+    {
+        glDispatchComputeExt = (PFN_glDispatchCompute)glfwGetProcAddress("glDispatchCompute");
+        glBindImageTextureExt = (PFN_glBindImageTexture)glfwGetProcAddress("glBindImageTexture");
+        glMemoryBarrierExt = (PFN_glMemoryBarrier)glfwGetProcAddress("glMemoryBarrier");
+    }
+    capabilities.computeShaders = glDispatchComputeExt && glBindImageTextureExt && glMemoryBarrierExt;
+
+    if (VersionAtLeast(4, 3) || HasExtension("GL_ARB_invalidate_subdata"))
+    {
+        glInvalidateFramebufferExt = (PFN_glInvalidateFramebuffer)glfwGetProcAddress("glInvalidateFramebuffer");
+        glInvalidateTexImageExt = (PFN_glInvalidateTexImage)glfwGetProcAddress("glInvalidateTexImage");
+    }
+    capabilities.invalidateSubdata = glInvalidateFramebufferExt && glInvalidateTexImageExt;
+
+    std::cout << "OpenGL " << capabilities.major << "." << capabilities.minor
+              << (capabilities.multiDrawIndirect ? ", multi-draw indirect" : ", draw loop fallback")
+              << (capabilities.computeShaders ? ", compute shaders" : "") << std::endl;
+}
+
+const GLCapabilities &GetGLCapabilities()
+{
+    return capabilities;
+}
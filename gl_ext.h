@@ -0,0 +1,50 @@
+#pragma once
+#include "glad/glad.h"
+
+// The bundled glad loader is generated for GL 3.3 only. Entry points from newer
+// versions are resolved here at runtime and are null when the context lacks them.
+
+#ifndef GL_DRAW_INDIRECT_BUFFER
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#endif
+#ifndef GL_COMPUTE_SHADER
+#define GL_COMPUTE_SHADER 0x91B9
+#endif
+#ifndef GL_SHADER_IMAGE_ACCESS_BARRIER_BIT
+#define GL_SHADER_IMAGE_ACCESS_BARRIER_BIT 0x00000020
+#endif
+#ifndef GL_TEXTURE_FETCH_BARRIER_BIT
+#define GL_TEXTURE_FETCH_BARRIER_BIT 0x00000008
+#endif
+#ifndef GL_FRAMEBUFFER_BARRIER_BIT
+#define GL_FRAMEBUFFER_BARRIER_BIT 0x00000400
+#endif
+
+typedef void(APIENTRYP PFN_glMultiDrawElementsIndirect)(GLenum mode, GLenum type, const void *indirect, GLsizei drawcount, GLsizei stride);
+typedef void(APIENTRYP PFN_glDispatchCompute)(GLuint num_groups_x, GLuint num_groups_y, GLuint num_groups_z);
+typedef void(APIENTRYP PFN_glBindImageTexture)(GLuint unit, GLuint texture, GLint level, GLboolean layered, GLint layer, GLenum access, GLenum format);
+typedef void(APIENTRYP PFN_glMemoryBarrier)(GLbitfield barriers);
+typedef void(APIENTRYP PFN_glInvalidateFramebuffer)(GLenum target, GLsizei numAttachments, const GLenum *attachments);
+typedef void(APIENTRYP PFN_glInvalidateTexImage)(GLuint texture, GLint level);
+
+struct GLCapabilities
+{
+    int major = 3;
+    int minor = 3;
+    bool multiDrawIndirect = false;
+    // compute shaders with image load/store
+    bool computeShaders = false;
+    // discarding framebuffer and texture contents that are no longer needed
+    bool invalidateSubdata = false;
+};
+
+extern PFN_glMultiDrawElementsIndirect glMultiDrawElementsIndirectExt;
+extern PFN_glDispatchCompute glDispatchComputeExt;
+extern PFN_glBindImageTexture glBindImageTextureExt;
+extern PFN_glMemoryBarrier glMemoryBarrierExt;
+extern PFN_glInvalidateFramebuffer glInvalidateFramebufferExt;
+extern PFN_glInvalidateTexImage glInvalidateTexImageExt;
+
+// must be called after glad has been initialized on the current context
+void LoadGLExtensions();
+const GLCapabilities &GetGLCapabilities();
@@ -0,0 +1,53 @@
+#include "gpu_timer.h"
+
+GpuTimer::~GpuTimer()
+{
+    if (m_queries[0] != 0)
+        glDeleteQueries(LATENCY, m_queries);
+}
+
+void GpuTimer::Collect(bool wait)
+{
+    // oldest query first, so results arrive in submission order
+    for (int i = 0; i < LATENCY; ++i)
+    {
+        int slot = (m_next + i) % LATENCY;
+        if (!m_pending[slot])
+            continue;
+        GLint available = 0;
+        glGetQueryObjectiv(m_queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available && !(wait && slot == m_next))
+            return;
+        GLuint64 nanoseconds = 0;
+        glGetQueryObjectui64v(m_queries[slot], GL_QUERY_RESULT, &nanoseconds);
+        m_milliseconds = nanoseconds * 1e-6;
+        m_totalMilliseconds += m_milliseconds;
+        m_pending[slot] = false;
+        ++m_resultCount;
+    }
+}
+
+void GpuTimer::Begin()
+{
+    if (m_queries[0] == 0)
+        glGenQueries(LATENCY, m_queries);
+    // the ring is full only when results are never polled; then the oldest one has to be waited for
+    if (m_pending[m_next])
+        Collect(true);
+    glBeginQuery(GL_TIME_ELAPSED, m_queries[m_next]);
+}
+
+void GpuTimer::End()
+{
+    glEndQuery(GL_TIME_ELAPSED);
+    m_pending[m_next] = true;
+    m_next = (m_next + 1) % LATENCY;
+}
+
+bool GpuTimer::Update()
+{
+    uint64_t before = m_resultCount;
+    if (m_queries[0] != 0)
+        Collect(false);
+    return m_resultCount != before;
+}
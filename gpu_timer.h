@@ -0,0 +1,50 @@
+#pragma once
+#include "utils.h"
+#include <cstdint>
+
+// GPU time of a span of commands, measured with GL_TIME_ELAPSED queries. Results are collected a few frames
+// late from a ring of queries so that reading them never stalls the pipeline. Only one timer can be running
+// at a time, GL does not nest time-elapsed queries.
+class GpuTimer
+{
+private:
+    static constexpr int LATENCY = 4;
+    GLuint m_queries[LATENCY] = {};
+    bool m_pending[LATENCY] = {};
+    int m_next = 0;
+    double m_milliseconds = 0.0;
+    double m_totalMilliseconds = 0.0;
+    uint64_t m_resultCount = 0;
+
+    void Collect(bool wait);
+
+public:
+    GpuTimer() = default;
+    GpuTimer(const GpuTimer &) = delete;
+    GpuTimer &operator=(const GpuTimer &) = delete;
+    ~GpuTimer();
+
+    void Begin();
+    void End();
+    // polls finished queries; returns true when at least one new result arrived since the last call
+    bool Update();
+    // most recent result
+    double GetMilliseconds() const
+    {
+        return m_milliseconds;
+    }
+    // number of results collected since the last ResetStatistics
+    uint64_t GetResultCount() const
+    {
+        return m_resultCount;
+    }
+    double GetAverageMilliseconds() const
+    {
+        return m_resultCount > 0 ? m_totalMilliseconds / m_resultCount : 0.0;
+    }
+    void ResetStatistics()
+    {
+        m_totalMilliseconds = 0.0;
+        m_resultCount = 0;
+    }
+};
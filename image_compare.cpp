@@ -0,0 +1,52 @@
+#include "image_compare.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+ImageDifference CompareImages(const std::vector<unsigned char> &reference, const std::vector<unsigned char> &image, double tolerance)
+{
+    ImageDifference difference;
+    if (reference.size() != image.size())
+    {
+        difference.maxError = difference.rootMeanSquare = difference.outlierFraction = 1.0;
+        return difference;
+    }
+    int toleranceSteps = (int)std::floor(tolerance * 255.0);
+    double squareSum = 0.0;
+    int maxSteps = 0;
+    size_t outliers = 0;
+    for (size_t pixel = 0; pixel < reference.size(); pixel += 4)
+    {
+        int pixelSteps = 0;
+        bool covered = false;
+        for (size_t channel = pixel; channel < pixel + 4; ++channel)
+        {
+            int steps = std::abs((int)reference[channel] - (int)image[channel]);
+            squareSum += (double)steps * steps;
+            pixelSteps = std::max(pixelSteps, steps);
+            covered = covered || reference[channel] != 0 || image[channel] != 0;
+        }
+        if (!covered)
+            continue;
+        ++difference.coveredPixels;
+        maxSteps = std::max(maxSteps, pixelSteps);
+        if (pixelSteps > toleranceSteps)
+            ++outliers;
+    }
+    if (difference.coveredPixels > 0)
+    {
+        difference.rootMeanSquare = std::sqrt(squareSum / (4.0 * difference.coveredPixels)) / 255.0;
+        difference.outlierFraction = (double)outliers / difference.coveredPixels;
+    }
+    difference.maxError = maxSteps / 255.0;
+    return difference;
+}
+
+std::vector<unsigned char> ReadPixels(GLenum attachment, GLsizei width, GLsizei height)
+{
+    std::vector<unsigned char> pixels(width * height * 4);
+    glReadBuffer(attachment);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    return pixels;
+}
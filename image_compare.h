@@ -0,0 +1,18 @@
+#pragma once
+#include "utils.h"
+
+// Per-channel difference of two RGBA8 images of the same size, in units of the full 8-bit range, over the
+// pixels covered in either image (any non-zero channel), so an empty background does not dilute it.
+struct ImageDifference
+{
+    double rootMeanSquare = 0.0;
+    double maxError = 0.0;
+    // fraction of the covered pixels with a channel off by more than the tolerance
+    double outlierFraction = 0.0;
+    size_t coveredPixels = 0;
+};
+
+ImageDifference CompareImages(const std::vector<unsigned char> &reference, const std::vector<unsigned char> &image, double tolerance);
+
+// RGBA8 contents of a color attachment of the framebuffer bound for reading
+std::vector<unsigned char> ReadPixels(GLenum attachment, GLsizei width, GLsizei height);
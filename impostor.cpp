@@ -0,0 +1,41 @@
+#include "impostor.h"
+#include <cmath>
+
+glm::vec3 GetImpostorViewDirection(int x, int y, int views)
+{
+    // octahedral decode of the grid vertex, like DecodeNormal in the shaders
+    glm::vec2 e = glm::vec2((float)x, (float)y) / (float)(views - 1) * 2.0f - 1.0f;
+    glm::vec3 n(e, 1.0f - std::abs(e.x) - std::abs(e.y));
+    float t = glm::clamp(-n.z, 0.0f, 1.0f);
+    n.x += n.x >= 0.0f ? -t : t;
+    n.y += n.y >= 0.0f ? -t : t;
+    return glm::normalize(n);
+}
+
+void GetImpostorViewMatrices(int x, int y, int views, float radius, glm::mat4 &view, glm::mat4 &projection)
+{
+    glm::vec3 direction = GetImpostorViewDirection(x, y, views);
+    // the up axis the impostor shader rebuilds the same basis from
+    glm::vec3 up = std::abs(direction.y) > 0.999f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    view = glm::lookAt(direction * (2.0f * radius), glm::vec3(0.0f), up);
+    projection = glm::ortho(-radius, radius, -radius, radius, radius, 3.0f * radius);
+}
+
+void BakeImpostorAtlas(const RenderTarget &atlas, int views, float radius,
+                       const std::function<void(const glm::mat4 &view, const glm::mat4 &projection, const glm::vec3 &viewPos)> &drawView)
+{
+    atlas.Bind();
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    GLsizei cellSize = atlas.GetWidth() / views;
+    for (int y = 0; y < views; ++y)
+    {
+        for (int x = 0; x < views; ++x)
+        {
+            glm::mat4 view, projection;
+            GetImpostorViewMatrices(x, y, views, radius, view, projection);
+            glViewport(x * cellSize, y * cellSize, cellSize, cellSize);
+            drawView(view, projection, GetImpostorViewDirection(x, y, views) * (1000.0f * radius));
+        }
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
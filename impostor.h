@@ -0,0 +1,20 @@
+#pragma once
+#include "render_target.h"
+#include <functional>
+
+// Octahedral impostor: an object rendered from views x views directions into the cells of an atlas. The view
+// directions sit on the vertices of a grid over the octahedral map of the sphere, so the views around any
+// direction are the four cells around its octahedral coordinates. Views are orthographic, looking at the
+// origin from outside a sphere of the given radius; the depth of a cell maps linearly to [radius, -radius]
+// along its view direction. Must match Resource/fur_impostor.fs.
+
+// direction from the object towards the eye of the view in cell (x, y)
+glm::vec3 GetImpostorViewDirection(int x, int y, int views);
+// orthographic view and projection of the view in cell (x, y)
+void GetImpostorViewMatrices(int x, int y, int views, float radius, glm::mat4 &view, glm::mat4 &projection);
+
+// Renders the views into the cells of atlas, which must be sized views * cellSize square and is cleared first.
+// drawView draws the object centered at the origin with the given matrices; viewPos is a distant eye on the
+// view direction, so view-dependent shading sees the parallel rays of the orthographic view.
+void BakeImpostorAtlas(const RenderTarget &atlas, int views, float radius,
+                       const std::function<void(const glm::mat4 &view, const glm::mat4 &projection, const glm::vec3 &viewPos)> &drawView);
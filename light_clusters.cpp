@@ -0,0 +1,245 @@
+#include "light_clusters.h"
+#include "parallel.h"
+#include "screen_coverage.h"
+#include <algorithm>
+#include <cmath>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LIGHT_CLUSTERS_SSE2
+#endif
+
+namespace
+{
+// view-space bounds of a light and the range of clusters they touch
+struct LightBounds
+{
+    float x, y, depth, radius;
+    int sliceMin, sliceMax;
+    int tileMinY, tileMaxY;
+    bool visible;
+};
+
+// tiles covered by the projection of a sphere along one screen axis
+bool GetTileRange(float center, float depth, float radius, float projectionScale, int tiles, int &tileMin, int &tileMax)
+{
+    float uvMin, uvMax;
+    if (!ProjectSphereAxis(center, depth, radius, projectionScale, uvMin, uvMax))
+        return false;
+    tileMin = std::max(0, (int)std::floor(uvMin * tiles));
+    tileMax = std::min(tiles - 1, (int)std::floor(uvMax * tiles));
+    return true;
+}
+} // namespace
+
+LightClusters::~LightClusters()
+{
+    for (TextureBuffer *target : {&m_lights, &m_records, &m_indices})
+    {
+        if (target->buffer != 0)
+        {
+            glDeleteTextures(1, &target->texture);
+            glDeleteBuffers(1, &target->buffer);
+        }
+    }
+}
+
+void LightClusters::Upload(TextureBuffer &target, GLenum internalFormat, const void *data, GLsizeiptr size)
+{
+    if (target.buffer == 0)
+    {
+        glGenBuffers(1, &target.buffer);
+        glGenTextures(1, &target.texture);
+        glBindTexture(GL_TEXTURE_BUFFER, target.texture);
+        glTexBuffer(GL_TEXTURE_BUFFER, internalFormat, target.buffer);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+    }
+    glBindBuffer(GL_TEXTURE_BUFFER, target.buffer);
+    // orphan the previous frame's storage instead of waiting for the GPU to finish reading it
+    target.capacity = std::max(target.capacity, std::max<GLsizeiptr>(size, 16));
+    glBufferData(GL_TEXTURE_BUFFER, target.capacity, NULL, GL_STREAM_DRAW);
+    if (size > 0)
+        glBufferSubData(GL_TEXTURE_BUFFER, 0, size, data);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void LightClusters::Update(const std::vector<PointLight> &lights, const glm::mat4 &view, const glm::mat4 &projection)
+{
+    size_t lightCount = std::min<size_t>(lights.size(), 65536);
+    float zNear = projection[3][2] / (projection[2][2] - 1.0f);
+    float zFar = projection[3][2] / (projection[2][2] + 1.0f);
+    float logRange = std::log(zFar / zNear);
+    m_sliceScale = CLUSTER_SLICES / logRange;
+    m_sliceBias = -CLUSTER_SLICES * std::log(zNear) / logRange;
+    float scaleX = projection[0][0];
+    float scaleY = projection[1][1];
+
+    // 1. view-space bounds and conservative slice / row ranges of every light
+    std::vector<LightBounds> bounds(lightCount);
+    m_lightData.resize(lightCount * 2);
+    ParallelFor(lightCount, 64, [&](size_t begin, size_t end)
+                {
+        for (size_t i = begin; i < end; ++i)
+        {
+            const PointLight &light = lights[i];
+            m_lightData[i * 2] = glm::vec4(light.position, light.radius);
+            m_lightData[i * 2 + 1] = glm::vec4(light.color, 0.0f);
+
+            LightBounds &b = bounds[i];
+            glm::vec4 center = view * glm::vec4(light.position, 1.0f);
+            b.x = center.x;
+            b.y = center.y;
+            b.depth = -center.z;
+            b.radius = light.radius;
+            b.visible = b.depth + light.radius > zNear && b.depth - light.radius < zFar;
+            if (!b.visible)
+                continue;
+            auto slice = [&](float depth)
+            {
+                return std::min(CLUSTER_SLICES - 1, std::max(0, (int)std::floor(std::log(std::max(depth, zNear)) * m_sliceScale + m_sliceBias)));
+            };
+            b.sliceMin = slice(b.depth - light.radius);
+            b.sliceMax = slice(b.depth + light.radius);
+            int tileMinX, tileMaxX;
+            b.visible = GetTileRange(b.x, b.depth, light.radius, scaleX, CLUSTER_TILES_X, tileMinX, tileMaxX) &&
+                        GetTileRange(b.y, b.depth, light.radius, scaleY, CLUSTER_TILES_Y, b.tileMinY, b.tileMaxY);
+        } });
+
+    // 2. exact sphere / cluster box tests, one depth slice per job and four lights per SIMD test
+    m_recordData.resize(CLUSTER_COUNT);
+    std::vector<std::vector<uint16_t>> sliceIndices(CLUSTER_SLICES);
+    ParallelFor(CLUSTER_SLICES, 1, [&](size_t begin, size_t end)
+                {
+        std::vector<float> rowX, rowY, rowDepth, rowRadius2;
+        std::vector<uint16_t> rowLights;
+        for (size_t s = begin; s < end; ++s)
+        {
+            std::vector<uint16_t> &indices = sliceIndices[s];
+            float depthNear = std::exp((s - m_sliceBias) / m_sliceScale);
+            float depthFar = std::exp((s + 1 - m_sliceBias) / m_sliceScale);
+            for (int y = 0; y < CLUSTER_TILES_Y; ++y)
+            {
+                rowX.clear();
+                rowY.clear();
+                rowDepth.clear();
+                rowRadius2.clear();
+                rowLights.clear();
+                for (size_t i = 0; i < lightCount; ++i)
+                {
+                    const LightBounds &b = bounds[i];
+                    if (!b.visible || (int)s < b.sliceMin || (int)s > b.sliceMax || y < b.tileMinY || y > b.tileMaxY)
+                        continue;
+                    rowX.push_back(b.x);
+                    rowY.push_back(b.y);
+                    rowDepth.push_back(b.depth);
+                    rowRadius2.push_back(b.radius * b.radius);
+                    rowLights.push_back((uint16_t)i);
+                }
+                // padding lights have a negative squared radius and never pass
+                while (rowLights.size() % 4 != 0)
+                {
+                    rowX.push_back(0.0f);
+                    rowY.push_back(0.0f);
+                    rowDepth.push_back(0.0f);
+                    rowRadius2.push_back(-1.0f);
+                    rowLights.push_back(0);
+                }
+
+                // view-space box of the clusters of this row and slice
+                float ndcY0 = -1.0f + 2.0f * y / CLUSTER_TILES_Y;
+                float ndcY1 = -1.0f + 2.0f * (y + 1) / CLUSTER_TILES_Y;
+                float minY = std::min(ndcY0 * depthNear, ndcY0 * depthFar) / scaleY;
+                float maxY = std::max(ndcY1 * depthNear, ndcY1 * depthFar) / scaleY;
+                for (int x = 0; x < CLUSTER_TILES_X; ++x)
+                {
+                    float ndcX0 = -1.0f + 2.0f * x / CLUSTER_TILES_X;
+                    float ndcX1 = -1.0f + 2.0f * (x + 1) / CLUSTER_TILES_X;
+                    float minX = std::min(ndcX0 * depthNear, ndcX0 * depthFar) / scaleX;
+                    float maxX = std::max(ndcX1 * depthNear, ndcX1 * depthFar) / scaleX;
+                    GLuint first = (GLuint)indices.size();
+                    size_t i = 0;
+#ifdef LIGHT_CLUSTERS_SSE2
+                    const __m128 vZero = _mm_setzero_ps();
+                    const __m128 vMinX = _mm_set1_ps(minX), vMaxX = _mm_set1_ps(maxX);
+                    const __m128 vMinY = _mm_set1_ps(minY), vMaxY = _mm_set1_ps(maxY);
+                    const __m128 vNear = _mm_set1_ps(depthNear), vFar = _mm_set1_ps(depthFar);
+                    for (; i < rowLights.size(); i += 4)
+                    {
+                        __m128 cx = _mm_loadu_ps(&rowX[i]);
+                        __m128 cy = _mm_loadu_ps(&rowY[i]);
+                        __m128 cz = _mm_loadu_ps(&rowDepth[i]);
+                        __m128 dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(vMinX, cx), _mm_sub_ps(cx, vMaxX)), vZero);
+                        __m128 dy = _mm_max_ps(_mm_max_ps(_mm_sub_ps(vMinY, cy), _mm_sub_ps(cy, vMaxY)), vZero);
+                        __m128 dz = _mm_max_ps(_mm_max_ps(_mm_sub_ps(vNear, cz), _mm_sub_ps(cz, vFar)), vZero);
+                        __m128 distance2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+                        int mask = _mm_movemask_ps(_mm_cmple_ps(distance2, _mm_loadu_ps(&rowRadius2[i])));
+                        for (int lane = 0; mask != 0; ++lane, mask >>= 1)
+                        {
+                            if (mask & 1)
+                                indices.push_back(rowLights[i + lane]);
+                        }
+                    }
+#endif
+                    for (; i < rowLights.size(); ++i)
+                    {
+                        float dx = std::max(std::max(minX - rowX[i], rowX[i] - maxX), 0.0f);
+                        float dy = std::max(std::max(minY - rowY[i], rowY[i] - maxY), 0.0f);
+                        float dz = std::max(std::max(depthNear - rowDepth[i], rowDepth[i] - depthFar), 0.0f);
+                        if (dx * dx + dy * dy + dz * dz <= rowRadius2[i])
+                            indices.push_back(rowLights[i]);
+                    }
+                    // offsets are local to the slice until the lists are concatenated
+                    m_recordData[(s * CLUSTER_TILES_Y + y) * CLUSTER_TILES_X + x] = glm::uvec2(first, (GLuint)indices.size() - first);
+                }
+            }
+        } });
+
+    // 3. concatenate the slice lists
+    m_indexData.clear();
+    for (int s = 0; s < CLUSTER_SLICES; ++s)
+    {
+        GLuint base = (GLuint)m_indexData.size();
+        for (int c = s * CLUSTER_TILES_X * CLUSTER_TILES_Y; c < (s + 1) * CLUSTER_TILES_X * CLUSTER_TILES_Y; ++c)
+            m_recordData[c].x += base;
+        m_indexData.insert(m_indexData.end(), sliceIndices[s].begin(), sliceIndices[s].end());
+    }
+
+    Upload(m_lights, GL_RGBA32F, m_lightData.data(), m_lightData.size() * sizeof(glm::vec4));
+    Upload(m_records, GL_RG32UI, m_recordData.data(), m_recordData.size() * sizeof(glm::uvec2));
+    Upload(m_indices, GL_R16UI, m_indexData.data(), m_indexData.size() * sizeof(uint16_t));
+}
+
+void LightClusters::Bind(GLShader &shader, GLuint firstUnit) const
+{
+    const TextureBuffer *targets[3] = {&m_lights, &m_records, &m_indices};
+    const char *names[3] = {"clusterLights", "clusterRecords", "clusterIndices"};
+    for (GLuint i = 0; i < 3; ++i)
+    {
+        glActiveTexture(GL_TEXTURE0 + firstUnit + i);
+        glBindTexture(GL_TEXTURE_BUFFER, targets[i]->texture);
+        shader.SetUniform(names[i], (int)(firstUnit + i));
+    }
+    shader.SetUniform("sliceScale", m_sliceScale);
+    shader.SetUniform("sliceBias", m_sliceBias);
+}
+
+void GenerateOrbitingLights(std::vector<PointLight> &lights, size_t count, const glm::vec3 &center, float time)
+{
+    lights.resize(count);
+    // low-discrepancy placement, so the distribution stays even for any count
+    const float goldenAngle = 2.39996323f;
+    for (size_t i = 0; i < count; ++i)
+    {
+        float t = (i + 0.5f) / count;
+        float height = 1.0f - 2.0f * t;
+        float ring = std::sqrt(1.0f - height * height);
+        float shell = 0.35f + 0.85f * std::fmod(i * 0.618034f, 1.0f);
+        // inner lights orbit faster
+        float angle = goldenAngle * i + time * 0.6f / shell;
+        PointLight &light = lights[i];
+        light.position = center + shell * glm::vec3(ring * std::cos(angle), height, ring * std::sin(angle));
+        light.radius = 0.3f + 0.2f * std::fmod(i * 0.381966f, 1.0f);
+        float hue = std::fmod(i * 0.137f, 1.0f) * 6.0f;
+        glm::vec3 color = glm::clamp(glm::vec3(std::abs(hue - 3.0f) - 1.0f, 2.0f - std::abs(hue - 2.0f), 2.0f - std::abs(hue - 4.0f)), 0.0f, 1.0f);
+        light.color = color * 0.25f;
+    }
+}
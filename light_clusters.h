@@ -0,0 +1,61 @@
+#pragma once
+#include "utils.h"
+#include <cstdint>
+
+// Froxel grid of the clustered lighting: screen tiles times exponential depth slices between the near and
+// far plane of the projection. Must match the CLUSTERED_LIGHTS permutation of the lighting pass.
+constexpr int CLUSTER_TILES_X = 16;
+constexpr int CLUSTER_TILES_Y = 9;
+constexpr int CLUSTER_SLICES = 24;
+constexpr int CLUSTER_COUNT = CLUSTER_TILES_X * CLUSTER_TILES_Y * CLUSTER_SLICES;
+
+// Point light with a finite range, in world space.
+struct PointLight
+{
+    glm::vec3 position;
+    float radius;
+    glm::vec3 color;
+};
+
+// Lights binned into the froxel grid on the worker threads every frame. The lighting pass reads three
+// texture buffers: the lights (two RGBA32F texels each: position + radius, color), one RG32UI record
+// (first index, count) per cluster and the R16UI light indices the records point into.
+class LightClusters
+{
+private:
+    struct TextureBuffer
+    {
+        GLuint buffer = 0;
+        GLuint texture = 0;
+        GLsizeiptr capacity = 0;
+    };
+    TextureBuffer m_lights;
+    TextureBuffer m_records;
+    TextureBuffer m_indices;
+    std::vector<glm::vec4> m_lightData;
+    std::vector<glm::uvec2> m_recordData;
+    std::vector<uint16_t> m_indexData;
+    float m_sliceScale = 0.0f;
+    float m_sliceBias = 0.0f;
+
+    void Upload(TextureBuffer &target, GLenum internalFormat, const void *data, GLsizeiptr size);
+
+public:
+    LightClusters() = default;
+    LightClusters(const LightClusters &) = delete;
+    LightClusters &operator=(const LightClusters &) = delete;
+    ~LightClusters();
+
+    // at most 65536 lights; projection must be a symmetric perspective projection
+    void Update(const std::vector<PointLight> &lights, const glm::mat4 &view, const glm::mat4 &projection);
+    // binds the buffers to firstUnit .. firstUnit + 2 and sets the cluster uniforms of a lighting permutation
+    void Bind(GLShader &shader, GLuint firstUnit) const;
+    // total length of the cluster lists, the work of the lighting pass
+    size_t GetIndexCount() const
+    {
+        return m_indexData.size();
+    }
+};
+
+// count lights scattered in a shell around center, orbiting it with time
+void GenerateOrbitingLights(std::vector<PointLight> &lights, size_t count, const glm::vec3 &center, float time);
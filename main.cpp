@@ -1,7 +1,70 @@
 #include "utils.h"
+#include "meshlet.h"
+#include "skinning.h"
+#include "render_graph.h"
+#include "fur_pattern.h"
+#include "fur_shading.h"
+#include "impostor.h"
+#include "light_clusters.h"
+#include "screen_coverage.h"
+#include "gpu_timer.h"
+#include "frame_governor.h"
+#include "image_compare.h"
+#include "pass_inputs.h"
+#include "occlusion_query.h"
+#include "gl_ext.h"
+#include <cstring>
+#include <cstdio>
+#include <algorithm>
+#include <cmath>
 
 const int SCR_WIDTH = 800;
 const int SCR_HEIGHT = 600;
+// The base surface is only needed as coarse depth, so it is rendered at reduced resolution from a
+// coarser LOD instead of repeating the full fur geometry pass
+const float BASE_PASS_SCALE = 0.5f;
+const unsigned int BASE_PASS_SEGMENTS = 32;
+// clamps of the adaptive fur march; the reference march uses 64 layers
+const int FUR_MIN_SAMPLES = 8;
+const int FUR_MAX_SAMPLES = 64;
+const int FUR_PYRAMID_LEVELS = 6;
+const int FUR_COARSE_SAMPLES = 12;
+const int FUR_REFINE_STEPS = 4;
+// the temporal march covers the 64 reference layers in 4 frames of 16 layers
+const int FUR_TEMPORAL_STRIDE = 4;
+const int FUR_TEMPORAL_MAX_HISTORY = 8;
+// work group tile of the compute fur pass
+const int FUR_COMPUTE_TILE = 16;
+// fur pass benchmark: frames measured per path, after a warm-up of a few frames
+const int BENCHMARK_FRAMES = 240;
+const int BENCHMARK_WARMUP = 30;
+// range of the clustered light count, changed with [ and ]
+const int CLUSTERED_LIGHTS_MIN = 100;
+const int CLUSTERED_LIGHTS_MAX = 500;
+// world-space bounding radius of the fur sphere; the animated creature bends out of it by up to half of it
+const float FUR_BOUNDS_RADIUS = 0.25f;
+const float FUR_ANIMATED_BOUNDS_SCALE = 1.5f;
+// distance from the base silhouette, in screen heights, over which the fur dissolves
+const float EDGE_DISSOLVE_WIDTH = 0.03f;
+// octahedral impostor atlas: views x views directions of IMPOSTOR_CELL_SIZE pixels each, used for static fur
+// objects whose bounds cover fewer than IMPOSTOR_SCREEN_SIZE framebuffer pixels vertically
+const int IMPOSTOR_VIEWS = 8;
+const int IMPOSTOR_CELL_SIZE = 128;
+const int IMPOSTOR_SCREEN_SIZE = 48;
+// golden-image check of the half-precision fur march (--compare-precision): bounds of the RMS error, and of the
+// fraction of covered pixels off by more than the tolerance, against the 32-bit march
+const double PRECISION_MAX_RMS = 2.0 / 255.0;
+const double PRECISION_TOLERANCE = 8.0 / 255.0;
+const double PRECISION_MAX_OUTLIERS = 0.001;
+// frame-time governor: GPU time per frame it holds, and its quality ladder from best to cheapest
+const double FRAME_TARGET_MILLISECONDS = 16.6;
+const QualityLevel QUALITY_LEVELS[] = {{1.0f, 64}, {1.0f, 48}, {0.75f, 48}, {0.75f, 32}, {0.5f, 32}, {0.5f, 16}};
+// layers of the reference march, the fur pass's SampleCount unless the governor lowers it
+const int FUR_REFERENCE_SAMPLES = 64;
+// longest wait for input while nothing on screen changes
+const double IDLE_WAIT_SECONDS = 0.25;
+// longest frame time fed to input and animation, so idle waits do not turn into one large step
+const float MAX_FRAME_SECONDS = 1.0f / 30.0f;
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
 float lastX = (float)SCR_WIDTH / 2.0;
@@ -9,11 +72,71 @@ float lastY = (float)SCR_HEIGHT / 2.0;
 EulerCamera camera(glm::vec3(0.0f, 0.0f, 1.f));
 
 bool firstMouse = true;
+bool animateFur = false;
+// internal resolution relative to the framebuffer, independent of the window size
+float renderScale = 1.0f;
+// layers of the fragment fur march (the SAMPLE_COUNT permutation below FUR_REFERENCE_SAMPLES)
+int furSampleCount = FUR_REFERENCE_SAMPLES;
+// render scale and fur layers follow the GPU frame time (G); changing the render scale by hand turns it off
+bool frameGovernor = true;
+// area fraction of the internal resolution the fur geometry pass renders at (1, 1/2 or 1/4)
+float furAreaScale = 1.0f;
+// lay down fur depth first so the fur march only runs on visible fragments
+bool furDepthPrepass = true;
+// Fur march variants, cycled with M. Reference is the fixed 64-layer march of the original shader.
+enum class FurMarchMode
+{
+    Reference,
+    Adaptive,
+    Hierarchical,
+    ConeStep,
+    Refined,
+    Temporal,
+    Count
+};
+const char *const FUR_MARCH_MODE_NAMES[] = {"reference", "adaptive", "hierarchical", "cone step", "coarse + bisection", "temporal"};
+const char *const FUR_MARCH_MODE_DEFINES[] = {"#define FIXED_SAMPLE_COUNT\n", "", "#define HIERARCHICAL_MARCH\n", "#define CONE_STEP_MARCH\n", "#define REFINED_MARCH\n", "#define TEMPORAL_MARCH\n"};
+FurMarchMode furMarchMode = FurMarchMode::Adaptive;
+// compute-shader fur pass instead of the fragment shader one (C, GL 4.3 only)
+bool computeFur = false;
+// frame of the running fur pass benchmark (B), -1 when idle
+int benchmarkFrame = -1;
+// hundreds of point lights binned into clusters on top of the key light (L)
+bool clusteredLights = false;
+int clusteredLightCount = 200;
+// thin out and fade the fur towards the silhouette (E), fragment fur pass only
+bool edgeDissolve = true;
+// Kajiya-Kay strand lighting along the surface tangent instead of Lambert (H)
+bool kajiyaKayShading = true;
+// skip the fur draws of objects whose base pass draw was hidden in the previous frame (O)
+bool furOcclusionCulling = true;
+// draw small static fur objects as impostors from the baked atlas (I)
+bool furImpostors = true;
+// march the fur on half of the pixels in an alternating checkerboard and reconstruct the rest (X)
+bool checkerboardFur = false;
+// color accumulation, layer weights and UV offsets of the fragment fur march in half precision (F)
+bool halfPrecisionFur = false;
+// the window contents were damaged and must be drawn again even if no input changed
+bool windowDamaged = false;
 void MouseCallback(GLFWwindow *window, double xposIn, double yposIn);
 void MouseScrollCallback(GLFWwindow *window, double xoffset, double yoffset);
+void KeyCallback(GLFWwindow *window, int key, int scancode, int action, int mods);
+void WindowRefreshCallback(GLFWwindow *window);
 
-int main()
+int main(int argc, char **argv)
 {
+    // --benchmark runs the fur pass benchmark once and exits
+    bool benchmarkAndExit = argc > 1 && std::strcmp(argv[1], "--benchmark") == 0;
+    if (benchmarkAndExit)
+        benchmarkFrame = 0;
+    // march settings of the user, restored when the benchmark ends
+    FurMarchMode benchmarkMarchMode = furMarchMode;
+    bool benchmarkHalfPrecision = halfPrecisionFur;
+    int benchmarkSampleCount = FUR_REFERENCE_SAMPLES;
+    float benchmarkRenderScale = 1.0f;
+    // --compare-precision renders the fur march in full and half precision, compares them and exits
+    bool comparePrecision = argc > 1 && std::strcmp(argv[1], "--compare-precision") == 0;
+
     GLFWwindow *window = nullptr;
     if (GlfwGladInitialization(&window, SCR_WIDTH, SCR_HEIGHT, "FurRenderingShader") == -1)
     {
@@ -25,184 +148,850 @@ int main()
     glfwSetFramebufferSizeCallback(window, FramebufferSizeCallback);
     glfwSetCursorPosCallback(window, MouseCallback);
     glfwSetScrollCallback(window, MouseScrollCallback);
+    glfwSetKeyCallback(window, KeyCallback);
+    glfwSetWindowRefreshCallback(window, WindowRefreshCallback);
 
-    glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
     // Setup some OpenGL options
     glEnable(GL_DEPTH_TEST);
 
     // Setup and compile our shaders
     GLuint diffuseTex = LoadTexture("Resource/fur_color.jpg");
-    GLuint noiseTex = LoadTexture("Resource/FurPattern_05_v2.png");
-    GLShader shaderGeometryPass("Resource/g_buffer_fur");
-    GLShader shaderLightingPass("Resource/lightpass_fur");
+    GLuint noiseTex = LoadTexture("Resource/FurPattern_05_v2.PNG");
+    // empty-space skipping structures for the hierarchical and cone step fur marches, baked at load time
+    FurPattern furPattern = LoadFurPattern("Resource/FurPattern_05_v2.PNG");
+    GLuint maxHeightTex = BakeMaxHeightPyramid(furPattern, FUR_PYRAMID_LEVELS);
+    ConeStepMap coneStepMap = BakeConeStepMap(furPattern);
+    // strand lighting terms of the Kajiya-Kay shading
+    GLuint kajiyaKayLut = BakeKajiyaKayLut();
+    // The fur geometry pass has several permutations (skinning, depth-only, march variants)
+    GLShaderPermutations furGeometryPasses("Resource/g_buffer_fur");
+    // Lighting permutations: upsampling of a reduced-resolution gBuffer, clustered point lights
+    GLShaderPermutations lightingPasses("Resource/lightpass_fur");
     GLShader shaderBasePass("Resource/g_buffer_fur_stencil");
-
-    // Set samplers
-    shaderLightingPass.Use();
-    shaderLightingPass.SetUniform("gPosition", 0);
-    shaderLightingPass.SetUniform("gNormal", 1);
-    shaderLightingPass.SetUniform("gAlbedoSpec", 2);
+    // Reduced-resolution fur: full-resolution depth/normal prepass + joint bilateral upsampling in the lighting pass
+    GLShader shaderPrepass("Resource/fur_prepass");
+    // full-screen passes share the quad vertex shader of the lighting pass
+    const std::string quadVertexShader = "Resource/lightpass_fur";
+    GLShader shaderTemporalResolve("Resource/fur_temporal", false, "", quadVertexShader);
+    GLShader shaderCheckerboardResolve("Resource/fur_checkerboard", false, "", quadVertexShader);
+    // Jump flooding from the base silhouette for the edge dissolve: SEED, step (no define) and RESOLVE passes
+    GLShaderPermutations jumpFloodPasses("Resource/jump_flood", quadVertexShader);
+    // Billboards of distant fur objects, blending the baked views of the impostor atlas
+    GLShaderPermutations impostorPasses("Resource/fur_impostor");
+    // Compute fur pass: the raster pass only sets up the rays, the reference march runs in screen tiles
+    bool furComputeAvailable = GetGLCapabilities().computeShaders;
+    GLShaderPermutations furComputePasses("Resource/g_buffer_fur");
+    // Skinned permutations for animated creatures
+    const std::string skinnedDefines = "#define SKINNED\n#define MAX_BONES " + std::to_string(MAX_BONES) + "\n";
+    GLShader shaderBasePassSkinned("Resource/g_buffer_fur_stencil", false, skinnedDefines);
+    GLShader shaderPrepassSkinned("Resource/fur_prepass", false, skinnedDefines);
+    furGeometryPasses.SetUniformBlock("BonePalette", BONE_PALETTE_BINDING);
+    shaderBasePassSkinned.SetUniformBlock("BonePalette", BONE_PALETTE_BINDING);
+    shaderPrepassSkinned.SetUniformBlock("BonePalette", BONE_PALETTE_BINDING);
 
     // Models
     glm::vec3 objectPos = glm::vec3(0,0,0);
     glm::vec3 lightPos = glm::vec3(0.0f, 2.0f, 2.0f);
+    std::vector<PointLight> pointLights;
+    LightClusters lightClusters;
 
-    // Set up Stencil-Buffer
-    GLuint gBufferStencil;
-    GLuint gPositionStencil;
+    // Passes are declared every frame in a render graph; their transient textures come from a shared pool and
+    // follow the framebuffer size (times renderScale)
+    RenderTargetPool renderTargetPool;
+    RenderGraph renderGraph(renderTargetPool);
+    // Ping-pong history of the temporal and checkerboard fur marches: resolved albedo, depth + frame count, normal
+    RenderTarget furHistory[2];
+    for (auto &history : furHistory)
     {
-        glGenFramebuffers(1, &gBufferStencil);
-        glBindFramebuffer(GL_FRAMEBUFFER, gBufferStencil);
-        glGenTextures(1, &gPositionStencil);
-        glBindTexture(GL_TEXTURE_2D, gPositionStencil);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGB, GL_FLOAT, NULL);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, gPositionStencil, 0);
-        GLuint attachments[1] = {GL_COLOR_ATTACHMENT0};
-        glDrawBuffers(1, attachments);
-        GLuint rboDepth;
-        glGenRenderbuffers(1, &rboDepth);
-        glBindRenderbuffer(GL_RENDERBUFFER, rboDepth);
-        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, SCR_WIDTH, SCR_HEIGHT);
-        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, rboDepth);
-        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-        {
-            std::cout << "Framebuffer not complete!" << std::endl;
-        }
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        history.AddAttachment(GL_COLOR_ATTACHMENT0, GL_RGBA16F, GL_LINEAR);
+        history.AddAttachment(GL_COLOR_ATTACHMENT1, GL_RG32F);
+        history.AddAttachment(GL_COLOR_ATTACHMENT2, GL_RG16);
     }
+    // gBuffer kept across frames, at the fur pass and (for the upsample guide) the internal resolution
+    RenderTarget gBufferCache;
+    gBufferCache.AddAttachment(GL_COLOR_ATTACHMENT0, GL_RG16);
+    gBufferCache.AddAttachment(GL_COLOR_ATTACHMENT1, GL_RGBA8);
+    gBufferCache.AddAttachment(GL_COLOR_ATTACHMENT2, GL_RG16);
+    gBufferCache.AddAttachment(GL_DEPTH_ATTACHMENT, GL_DEPTH_COMPONENT24);
+    RenderTarget prepassCache;
+    prepassCache.AddAttachment(GL_COLOR_ATTACHMENT0, GL_RG16);
+    prepassCache.AddAttachment(GL_DEPTH_ATTACHMENT, GL_DEPTH_COMPONENT24);
+    // inputs of the passes up to the gBuffer, and of the lighting pass
+    PassInputs geometryInputs;
+    PassInputs lightingInputs;
+    bool idle = false;
+    // the last checkerboard frame after a change only marched half of the pixels
+    bool checkerboardIncomplete = false;
+    uint64_t frameIndex = 0;
+    // holds the GPU time of the passes below FRAME_TARGET_MILLISECONDS; the quality shows in the window title
+    FrameGovernor governor(std::vector<QualityLevel>(std::begin(QUALITY_LEVELS), std::end(QUALITY_LEVELS)), FRAME_TARGET_MILLISECONDS);
+    double lastTelemetryTime = 0.0;
+    bool governorActive = false;
+    // GPU time of the fur pass on the fragment and the compute path, the sum of their graph passes
+    const char *const fragmentFurPasses[] = {"fur depth prepass", "fur geometry"};
+    const char *const computeFurPasses[] = {"fur rays", "fur march"};
+    // visibility of the fur object in the base pass, the condition of its fur draws
+    OcclusionQuery furOcclusion;
 
-    // Set up G-Buffer
-    GLuint gBuffer;
-    GLuint gPosition, gNormal, gAlbedoSpec;
+    // Fur geometry is split into meshlets; each pass draws the meshlets that survive CPU culling
+    // as one draw list out of the shared arena
+    const MeshletMesh &sphereMeshlets = GetSphereMeshlets();
+    const MeshletMesh &baseSphereMeshlets = GetSphereMeshlets(BASE_PASS_SEGMENTS);
+    DrawList baseDrawList;
+    DrawList furDrawList;
+
+    // Octahedral impostor of the static fur sphere, baked once with the reference march of the fur geometry pass
+    RenderTarget impostorAtlas;
+    impostorAtlas.AddAttachment(GL_COLOR_ATTACHMENT0, GL_RG16);
+    impostorAtlas.AddAttachment(GL_COLOR_ATTACHMENT1, GL_RGBA8, GL_LINEAR);
+    impostorAtlas.AddAttachment(GL_COLOR_ATTACHMENT2, GL_RG16);
+    impostorAtlas.AddAttachment(GL_DEPTH_ATTACHMENT, GL_DEPTH_COMPONENT24);
+    impostorAtlas.Resize(renderTargetPool, IMPOSTOR_VIEWS * IMPOSTOR_CELL_SIZE, IMPOSTOR_VIEWS * IMPOSTOR_CELL_SIZE);
+    BakeImpostorAtlas(impostorAtlas, IMPOSTOR_VIEWS, FUR_BOUNDS_RADIUS, [&](const glm::mat4 &view, const glm::mat4 &projection, const glm::vec3 &viewPos)
+                      {
+        GLShader &bakePass = furGeometryPasses.Get("#define FIXED_SAMPLE_COUNT\n#define STORE_TANGENT\n");
+        bakePass.Use();
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, diffuseTex);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, noiseTex);
+        bakePass.SetUniform("texture_diffuse", 0);
+        bakePass.SetUniform("texture_noise", 1);
+        bakePass.SetUniform("projection", projection);
+        bakePass.SetUniform("view", view);
+        bakePass.SetUniform("viewPos", viewPos);
+        glm::mat4 model = glm::scale(glm::mat4(1.0f), glm::vec3(0.25f));
+        bakePass.SetUniform("model", model);
+        bakePass.SetUniform("normalMatrix", glm::transpose(glm::inverse(glm::mat3(model))));
+        GeometryArena::Instance().Draw(sphereMeshlets.mesh); });
+
+    if (comparePrecision)
     {
-        glGenFramebuffers(1, &gBuffer);
-        glBindFramebuffer(GL_FRAMEBUFFER, gBuffer);
-        // - Position color buffer
-        glGenTextures(1, &gPosition);
-        glBindTexture(GL_TEXTURE_2D, gPosition);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGB, GL_FLOAT, NULL);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, gPosition, 0);
-        // - Normal color buffer
-        glGenTextures(1, &gNormal);
-        glBindTexture(GL_TEXTURE_2D, gNormal);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGB, GL_FLOAT, NULL);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, gNormal, 0);
-        // - Color + Specular color buffer
-        glGenTextures(1, &gAlbedoSpec);
-        glBindTexture(GL_TEXTURE_2D, gAlbedoSpec);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, gAlbedoSpec, 0);
-        // - Tell OpenGL which color attachments we'll use (of this framebuffer) for rendering
-        GLuint attachments[3] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2};
-        glDrawBuffers(3, attachments);
-        // - Create and attach depth buffer (renderbuffer)
-        GLuint rboDepth;
-        glGenRenderbuffers(1, &rboDepth);
-        glBindRenderbuffer(GL_RENDERBUFFER, rboDepth);
-        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, SCR_WIDTH, SCR_HEIGHT);
-        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, rboDepth);
-        // - Finally check if framebuffer is complete
-        
-        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-        {
-            std::cout << "Framebuffer not complete!" << std::endl;
-        }
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        // The 32-bit march is the golden image; the half-precision permutation must stay within the error bounds
+        RenderTarget compareTarget;
+        compareTarget.AddAttachment(GL_COLOR_ATTACHMENT0, GL_RG16);
+        compareTarget.AddAttachment(GL_COLOR_ATTACHMENT1, GL_RGBA8);
+        compareTarget.AddAttachment(GL_DEPTH_ATTACHMENT, GL_DEPTH_COMPONENT24);
+        compareTarget.Resize(renderTargetPool, SCR_WIDTH, SCR_HEIGHT);
+        glm::mat4 projection = camera.GetProjectionMatrix(SCR_WIDTH, SCR_HEIGHT);
+        glm::mat4 view = camera.GetViewMatrix();
+        glm::mat4 model = glm::scale(glm::translate(glm::mat4(1.0f), objectPos), glm::vec3(0.25f));
+        auto renderFur = [&](const std::string &defines)
+        {
+            compareTarget.Bind();
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            GLShader &comparePass = furGeometryPasses.Get(defines);
+            comparePass.Use();
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, diffuseTex);
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D, noiseTex);
+            comparePass.SetUniform("texture_diffuse", 0);
+            comparePass.SetUniform("texture_noise", 1);
+            comparePass.SetUniform("projection", projection);
+            comparePass.SetUniform("view", view);
+            comparePass.SetUniform("viewPos", camera.GetPosition());
+            comparePass.SetUniform("minSampleCount", FUR_MIN_SAMPLES);
+            comparePass.SetUniform("maxSampleCount", FUR_MAX_SAMPLES);
+            comparePass.SetUniform("model", model);
+            comparePass.SetUniform("normalMatrix", glm::transpose(glm::inverse(glm::mat3(model))));
+            GeometryArena::Instance().Draw(sphereMeshlets.mesh);
+            return ReadPixels(GL_COLOR_ATTACHMENT1, SCR_WIDTH, SCR_HEIGHT);
+        };
+        bool passed = true;
+        for (FurMarchMode mode : {FurMarchMode::Reference, FurMarchMode::Adaptive})
+        {
+            std::string defines = FUR_MARCH_MODE_DEFINES[(int)mode];
+            std::vector<unsigned char> golden = renderFur(defines);
+            ImageDifference difference = CompareImages(golden, renderFur(defines + "#define HALF_PRECISION\n#define EMULATE_FP16\n"), PRECISION_TOLERANCE);
+            bool withinBounds = difference.coveredPixels > 0 && difference.rootMeanSquare <= PRECISION_MAX_RMS &&
+                                difference.outlierFraction <= PRECISION_MAX_OUTLIERS;
+            std::cout << "Half-precision " << FUR_MARCH_MODE_NAMES[(int)mode] << " march: RMS error " << difference.rootMeanSquare * 255.0
+                      << "/255, max " << difference.maxError * 255.0 << "/255, " << difference.outlierFraction * 100.0
+                      << "% of " << difference.coveredPixels << " pixels over " << PRECISION_TOLERANCE * 255.0 << "/255: "
+                      << (withinBounds ? "pass" : "FAIL") << std::endl;
+            passed = passed && withinBounds;
+        }
+        compareTarget.Release(renderTargetPool);
+        glfwTerminate();
+        return passed ? 0 : 1;
     }
 
+    // Animated creature (toggle with K), posed on the worker threads and skinned on the GPU
+    const SwayingSphere &creature = GetSwayingSphere();
+    std::vector<SkinnedInstance> skinnedInstances(1);
+    skinnedInstances[0].skeleton = &creature.skeleton;
+    skinnedInstances[0].clip = &creature.clip;
+    BonePalette bonePalette;
+
     glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
 
     // Game loop
     while (!glfwWindowShouldClose(window))
     {
+        // while the image stays the same the loop sleeps until input arrives
+        if (idle)
+            glfwWaitEventsTimeout(IDLE_WAIT_SECONDS);
+        else
+            glfwPollEvents();
         float currentFrame = static_cast<float>(glfwGetTime());
-        deltaTime = currentFrame - lastFrame;
+        deltaTime = std::min(currentFrame - lastFrame, MAX_FRAME_SECONDS);
         lastFrame = currentFrame;
         if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         {
             glfwSetWindowShouldClose(window, true);
         }
-        glfwPollEvents();
 
+        int framebufferWidth, framebufferHeight;
+        glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+        if (framebufferWidth == 0 || framebufferHeight == 0)
         {
-            // 1. Fur Base Pass
-            glBindFramebuffer(GL_FRAMEBUFFER, gBufferStencil);
-            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-            glm::mat4 projection = camera.GetProjectionMatrix(SCR_WIDTH, SCR_HEIGHT);
-            glm::mat4 view = camera.GetViewMatrix();
-            glm::mat4 model = glm::mat4(1.0f);
-            shaderBasePass.Use();
-            shaderBasePass.SetUniform("projection", projection);
-            shaderBasePass.SetUniform("view", view);
-            model = glm::translate(model, objectPos);
-            model = glm::scale(model, glm::vec3(0.225f));
-            shaderBasePass.SetUniform("model", model);
-            RenderSphere();
-            glBindFramebuffer(GL_FRAMEBUFFER, 0);
-        }
-
-        {
-            // 2. Geometry Pass
-            glBindFramebuffer(GL_FRAMEBUFFER, gBuffer);
-            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, diffuseTex);
-            glActiveTexture(GL_TEXTURE1);
-            glBindTexture(GL_TEXTURE_2D, noiseTex);
-            glActiveTexture(GL_TEXTURE2);
-            glBindTexture(GL_TEXTURE_2D, gPositionStencil);
-            glm::mat4 projection = camera.GetProjectionMatrix(SCR_WIDTH, SCR_HEIGHT);
-            glm::mat4 view = camera.GetViewMatrix();
-            glm::mat4 model = glm::mat4(1.0f);
-            shaderGeometryPass.Use();
-            shaderGeometryPass.SetUniform("projection", projection);
-            shaderGeometryPass.SetUniform("view", view);
-            shaderGeometryPass.SetUniform("texture_diffuse", 0);
-            shaderGeometryPass.SetUniform("texture_noise", 1);
-            shaderGeometryPass.SetUniform("texture_basePosition", 2);
-
-            model = glm::translate(model, objectPos);
-            model = glm::scale(model, glm::vec3(0.25f));
-            shaderGeometryPass.SetUniform("model", model);
-            shaderGeometryPass.SetUniform("viewPos", camera.GetPosition());
-            RenderSphere();
-            glBindFramebuffer(GL_FRAMEBUFFER, 0);
-        }
-
-        {
-            // 3. Lighting Pass
-            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-            shaderLightingPass.Use();
+            // minimized
+            glfwWaitEvents();
+            continue;
+        }
+        if (frameGovernor != governorActive)
+        {
+            // switched on it starts again from the best level, switched off the fur gets all its layers back
+            governorActive = frameGovernor;
+            governor.Reset();
+            if (governorActive)
+                renderScale = governor.GetQuality().renderScale;
+            furSampleCount = governorActive ? governor.GetQuality().furSampleCount : FUR_REFERENCE_SAMPLES;
+        }
+        if (benchmarkFrame == 0)
+        {
+            // both paths run the full-precision reference march, the only one the compute path has, with all its
+            // layers at full render scale whatever level the governor is at; it does not step during the run
+            benchmarkMarchMode = furMarchMode;
+            benchmarkHalfPrecision = halfPrecisionFur;
+            benchmarkSampleCount = furSampleCount;
+            benchmarkRenderScale = renderScale;
+            furMarchMode = FurMarchMode::Reference;
+            halfPrecisionFur = false;
+            furSampleCount = FUR_REFERENCE_SAMPLES;
+            renderScale = 1.0f;
+        }
+        glm::mat4 projection = camera.GetProjectionMatrix(framebufferWidth, framebufferHeight);
+        glm::mat4 view = camera.GetViewMatrix();
+        camera.AdvanceFrame(projection * view);
+        // screen bounds of the fur object; small static ones are drawn as impostors, with none of the fur passes
+        ScreenRect furRect;
+        float furScreenHeight = 0.0f;
+        float furBoundsRadius = FUR_BOUNDS_RADIUS * (animateFur ? FUR_ANIMATED_BOUNDS_SCALE : 1.0f);
+        bool furVisible = ProjectSphere(objectPos, furBoundsRadius, view, projection, framebufferWidth, framebufferHeight, furRect, &furScreenHeight);
+        // the unclipped height, so a close object mostly off screen is not mistaken for a small one
+        bool furImpostor = furImpostors && !animateFur && furVisible && furScreenHeight < IMPOSTOR_SCREEN_SIZE;
+
+        GLsizei renderWidth = std::max(1, (int)(framebufferWidth * renderScale + 0.5f));
+        GLsizei renderHeight = std::max(1, (int)(framebufferHeight * renderScale + 0.5f));
+        // the fur pass renders at a fraction of the area of the internal resolution
+        bool reducedFur = furAreaScale < 1.0f && !furImpostor;
+        float furAxisScale = reducedFur ? std::sqrt(furAreaScale) : 1.0f;
+        GLsizei furWidth = std::max(1, (int)(renderWidth * furAxisScale + 0.5f));
+        GLsizei furHeight = std::max(1, (int)(renderHeight * furAxisScale + 0.5f));
+        GLsizei baseWidth = std::max(1, (int)(renderWidth * BASE_PASS_SCALE));
+        GLsizei baseHeight = std::max(1, (int)(renderHeight * BASE_PASS_SCALE));
+        if (benchmarkFrame >= 0)
+        {
+            // first half on the fragment path, second half on the compute path
+            computeFur = furComputeAvailable && benchmarkFrame >= BENCHMARK_FRAMES + BENCHMARK_WARMUP;
+            if (benchmarkFrame == BENCHMARK_WARMUP)
+                for (const char *pass : fragmentFurPasses)
+                    renderGraph.GetPassTimer(pass).ResetStatistics();
+            if (benchmarkFrame == 2 * BENCHMARK_WARMUP + BENCHMARK_FRAMES)
+                for (const char *pass : computeFurPasses)
+                    renderGraph.GetPassTimer(pass).ResetStatistics();
+        }
+        bool temporalFur = furMarchMode == FurMarchMode::Temporal && !furImpostor;
+        // the compute march is the full-precision reference march; other marches stay on the fragment path
+        bool furCompute = computeFur && furComputeAvailable && !furImpostor && furMarchMode == FurMarchMode::Reference && !halfPrecisionFur;
+        bool depthPrepass = furDepthPrepass && !furCompute && !furImpostor;
+        // the reference march stays complete, the temporal one already interleaves its layers across frames
+        bool checkerboard = checkerboardFur && !furCompute && !furImpostor && furMarchMode != FurMarchMode::Reference && !temporalFur;
+        // both resolve this frame's fur pass with the reprojected history into the albedo the lighting reads
+        bool furResolve = temporalFur || checkerboard;
+
+        // Only passes whose inputs changed are rendered. The gBuffer is kept, so when only lights change the lighting
+        // pass re-runs on it, and when nothing changes the frame is skipped and the last image stays on screen.
+        geometryInputs.Add(view).Add(projection).Add(objectPos).Add(furBoundsRadius).Add(renderWidth).Add(renderHeight).Add(furAreaScale);
+        geometryInputs.Add(animateFur).Add(furImpostor).Add(furCompute).Add(depthPrepass).Add(furMarchMode).Add(edgeDissolve).Add(kajiyaKayShading).Add(furOcclusionCulling).Add(checkerboard).Add(halfPrecisionFur).Add(furSampleCount);
+        // the skinned pose follows the clock
+        if (animateFur)
+            geometryInputs.Add(currentFrame);
+        lightingInputs.Add(framebufferWidth).Add(framebufferHeight).Add(lightPos).Add(clusteredLights);
+        if (clusteredLights)
+            lightingInputs.Add(clusteredLightCount).Add(currentFrame);
+        if (windowDamaged)
+            lightingInputs.Invalidate();
+        windowDamaged = false;
+        bool geometryChanged = geometryInputs.Update();
+        bool lightingChanged = lightingInputs.Update();
+        // the temporal accumulation and the benchmark change the gBuffer every frame
+        bool geometryDirty = geometryChanged || temporalFur || benchmarkFrame >= 0 || checkerboardIncomplete;
+        // one more frame marches the other half
+        checkerboardIncomplete = checkerboard && geometryChanged;
+        idle = !geometryDirty && !lightingChanged;
+        if (idle)
+            continue;
+        RenderTarget &historyRead = furHistory[frameIndex & 1];
+        RenderTarget &historyWrite = furHistory[(frameIndex + 1) & 1];
+        if (furResolve)
+        {
+            bool resized = historyRead.Resize(renderTargetPool, furWidth, furHeight);
+            resized = historyWrite.Resize(renderTargetPool, furWidth, furHeight) || resized;
+            if (resized)
+            {
+                // new textures hold garbage; zero frame counts make the resolve start over
+                historyRead.Bind();
+                glClear(GL_COLOR_BUFFER_BIT);
+                historyWrite.Bind();
+                glClear(GL_COLOR_BUFFER_BIT);
+            }
+        }
+        else
+        {
+            furHistory[0].Release(renderTargetPool);
+            furHistory[1].Release(renderTargetPool);
+        }
+
+        if (animateFur)
+        {
+            EvaluatePoses(skinnedInstances, deltaTime);
+            bonePalette.Upload(skinnedInstances);
+        }
+
+        auto drawFurGeometry = [&](GLShader &shader, const glm::mat4 &model, DrawList &drawList, const MeshletMesh &meshlets)
+        {
+            shader.SetUniform("model", model);
+            shader.SetUniform("normalMatrix", glm::transpose(glm::inverse(glm::mat3(model))));
+            if (animateFur)
+            {
+                // deformed meshes keep no valid meshlet bounds, so they are drawn whole
+                bonePalette.Bind(0);
+                GeometryArena::Instance().Draw(creature.mesh);
+            }
+            else
+            {
+                drawList.Clear();
+                CullMeshlets(meshlets, model, projection * view, camera.GetPosition(), drawList);
+                drawList.Submit();
+            }
+        };
+        if (clusteredLights)
+        {
+            GenerateOrbitingLights(pointLights, clusteredLightCount, objectPos, currentFrame);
+            lightClusters.Update(pointLights, view, projection);
+        }
+        glm::mat4 furModel = glm::scale(glm::translate(glm::mat4(1.0f), objectPos), glm::vec3(0.25f));
+        // fur draws of the fragment path, discarded on the GPU when the object was hidden in the last base pass
+        furOcclusion.NewFrame();
+        auto drawVisibleFur = [&](GLShader &shader)
+        {
+            if (furOcclusionCulling)
+                furOcclusion.BeginConditionalRender();
+            drawFurGeometry(shader, furModel, furDrawList, sphereMeshlets);
+            furOcclusion.EndConditionalRender();
+        };
+
+        // Resources of this frame. Positions are reconstructed from depth, so the base pass is depth-only;
+        // the gBuffer holds an octahedral normal (RG16) and color + specular (RGBA8): 8 bytes per pixel plus depth.
+        // The gBuffer outlives the frame, so that frames whose geometry inputs did not change only re-run lighting.
+        gBufferCache.Resize(renderTargetPool, furWidth, furHeight);
+        RenderResource gNormal = renderGraph.Import("gNormal", gBufferCache.GetTexture(GL_COLOR_ATTACHMENT0), {furWidth, furHeight, GL_RG16});
+        RenderResource gAlbedoSpec = renderGraph.Import("gAlbedoSpec", gBufferCache.GetTexture(GL_COLOR_ATTACHMENT1), {furWidth, furHeight, GL_RGBA8});
+        RenderResource gDepth = renderGraph.Import("gDepth", gBufferCache.GetTexture(GL_DEPTH_ATTACHMENT), {furWidth, furHeight, GL_DEPTH_COMPONENT24});
+        // strand direction of the Kajiya-Kay shading, octahedral like the normal
+        RenderResource gTangent;
+        std::string tangentDefines;
+        if (kajiyaKayShading)
+        {
+            gTangent = renderGraph.Import("gTangent", gBufferCache.GetTexture(GL_COLOR_ATTACHMENT2), {furWidth, furHeight, GL_RG16});
+            tangentDefines = "#define STORE_TANGENT\n";
+        }
+        RenderResource prepassNormal, prepassDepth;
+        if (reducedFur)
+        {
+            prepassCache.Resize(renderTargetPool, renderWidth, renderHeight);
+            prepassNormal = renderGraph.Import("prepass normal", prepassCache.GetTexture(GL_COLOR_ATTACHMENT0), {renderWidth, renderHeight, GL_RG16});
+            prepassDepth = renderGraph.Import("prepass depth", prepassCache.GetTexture(GL_DEPTH_ATTACHMENT), {renderWidth, renderHeight, GL_DEPTH_COMPONENT24});
+        }
+        else
+        {
+            prepassCache.Release(renderTargetPool);
+        }
+        // lighting reads the resolved albedo of the temporal or checkerboard march; the last one written is the
+        // previous history when the fur passes do not run
+        RenderResource lightingAlbedo = gAlbedoSpec;
+        if (furResolve && !geometryDirty)
+            lightingAlbedo = renderGraph.Import("previous albedo", historyRead.GetTexture(GL_COLOR_ATTACHMENT0), {furWidth, furHeight, GL_RGBA16F, GL_LINEAR});
+
+        // the passes run in Execute below, so resources their callbacks capture by reference are declared out here
+        RenderResource baseDepth, edgeDistance;
+        if (geometryDirty)
+        {
+            baseDepth = renderGraph.Create("base depth", {baseWidth, baseHeight, GL_DEPTH_COMPONENT24});
+            // lighting only shades covered pixels, but the upsample and the temporal neighbourhood clip also read
+            // background texels of the albedo, which must stay zero there
+            LoadOp albedoLoad = reducedFur || furResolve ? LoadOp::Clear : LoadOp::DontCare;
+
+            renderGraph.AddPass("base", [&]()
+                                {
+                // 1. Fur Base Pass: coarse depth of the skin surface, shared by everything that needs it
+                glm::mat4 model = glm::mat4(1.0f);
+                GLShader &basePass = animateFur ? shaderBasePassSkinned : shaderBasePass;
+                basePass.Use();
+                basePass.SetUniform("projection", projection);
+                basePass.SetUniform("view", view);
+                model = glm::translate(model, objectPos);
+                model = glm::scale(model, glm::vec3(0.225f));
+                drawFurGeometry(basePass, model, baseDrawList, baseSphereMeshlets);
+                // The query proxy is the fur shell the conditional draws rasterize, tested against the skin without
+                // writing depth, so any visible fringe keeps the fur. Only depth drawn before it can hide it: with a
+                // single object that is none, and the query just repeats the frustum test for off-screen objects.
+                glDepthMask(GL_FALSE);
+                furOcclusion.Begin();
+                drawFurGeometry(basePass, furModel, furDrawList, sphereMeshlets);
+                furOcclusion.End();
+                glDepthMask(GL_TRUE); })
+                .WriteAttachment(baseDepth, GL_DEPTH_ATTACHMENT, LoadOp::Clear);
+
+            if (edgeDissolve && !furCompute && !furImpostor)
+            {
+                // 1.25 Distance to the base silhouette by jump flooding at the base pass resolution. Only distances
+                // within the dissolve width matter, so the flood starts at that range: log2 of it in passes
+                int floodRange = std::max(1, (int)std::ceil(EDGE_DISSOLVE_WIDTH * baseHeight));
+                int firstStep = 1;
+                while (firstStep * 2 <= floodRange)
+                    firstStep *= 2;
+                RenderResource flood = renderGraph.Create("edge seeds", {baseWidth, baseHeight, GL_RG16I});
+                renderGraph.AddPass("edge seeds", [&]()
+                                    {
+                    GLShader &seedPass = jumpFloodPasses.Get("#define SEED\n");
+                    seedPass.Use();
+                    glActiveTexture(GL_TEXTURE0);
+                    glBindTexture(GL_TEXTURE_2D, renderGraph.GetTexture(baseDepth));
+                    seedPass.SetUniform("baseDepth", 0);
+                    RenderQuad(); })
+                    .Read(baseDepth)
+                    .WriteAttachment(flood, GL_COLOR_ATTACHMENT0, LoadOp::DontCare);
+                // every step writes a new resource; the graph hands dead ones back, so two textures ping-pong
+                for (int step = firstStep; step >= 1; step /= 2)
+                {
+                    RenderResource next = renderGraph.Create("edge flood", {baseWidth, baseHeight, GL_RG16I});
+                    renderGraph.AddPass("edge flood " + std::to_string(step), [&, flood, step]()
+                                        {
+                        GLShader &stepPass = jumpFloodPasses.Get();
+                        stepPass.Use();
+                        glActiveTexture(GL_TEXTURE0);
+                        glBindTexture(GL_TEXTURE_2D, renderGraph.GetTexture(flood));
+                        stepPass.SetUniform("seeds", 0);
+                        stepPass.SetUniform("stepSize", step);
+                        RenderQuad(); })
+                        .Read(flood)
+                        .WriteAttachment(next, GL_COLOR_ATTACHMENT0, LoadOp::DontCare);
+                    flood = next;
+                }
+                edgeDistance = renderGraph.Create("edge distance", {baseWidth, baseHeight, GL_R16F, GL_LINEAR});
+                renderGraph.AddPass("edge distance", [&, flood]()
+                                    {
+                    GLShader &resolvePass = jumpFloodPasses.Get("#define RESOLVE\n");
+                    resolvePass.Use();
+                    glActiveTexture(GL_TEXTURE0);
+                    glBindTexture(GL_TEXTURE_2D, renderGraph.GetTexture(baseDepth));
+                    glActiveTexture(GL_TEXTURE1);
+                    glBindTexture(GL_TEXTURE_2D, renderGraph.GetTexture(flood));
+                    resolvePass.SetUniform("baseDepth", 0);
+                    resolvePass.SetUniform("seeds", 1);
+                    resolvePass.SetUniform("distanceScale", 1.0f / baseHeight);
+                    RenderQuad(); })
+                    .Read(baseDepth)
+                    .Read(flood)
+                    .WriteAttachment(edgeDistance, GL_COLOR_ATTACHMENT0, LoadOp::DontCare);
+            }
+
+            if (reducedFur)
+            {
+                // Full-resolution guide for upsampling the reduced-resolution gBuffer
+                renderGraph.AddPass("upsample prepass", [&]()
+                                    {
+                    // 1.5 Full-resolution depth/normal prepass guiding the upsample
+                    GLShader &prepass = animateFur ? shaderPrepassSkinned : shaderPrepass;
+                    prepass.Use();
+                    prepass.SetUniform("projection", projection);
+                    prepass.SetUniform("view", view);
+                    drawVisibleFur(prepass); })
+                    .WriteAttachment(prepassNormal, GL_COLOR_ATTACHMENT0, LoadOp::DontCare)
+                    .WriteAttachment(prepassDepth, GL_DEPTH_ATTACHMENT, LoadOp::Clear);
+            }
+
+            if (depthPrepass)
+            {
+                renderGraph.AddPass("fur depth prepass", [&]()
+                                    {
+                    // 1.75 Fur depth prepass at the geometry pass resolution
+                    // depth-only permutation of the geometry pass, sharing its vertex shader so depth matches exactly
+                    GLShader &prepass = furGeometryPasses.Get(std::string("#define DEPTH_ONLY\n") + (animateFur ? skinnedDefines : ""));
+                    prepass.Use();
+                    prepass.SetUniform("projection", projection);
+                    prepass.SetUniform("view", view);
+                    drawVisibleFur(prepass); })
+                    .WriteAttachment(gDepth, GL_DEPTH_ATTACHMENT, LoadOp::Clear);
+            }
+
+            if (furImpostor)
+            {
+                // 2. Impostor of the fur object: one quad blending the baked views into the gBuffer
+                RenderPass &impostor = renderGraph.AddPass("fur impostor", [&]()
+                                                           {
+                    GLShader &impostorPass = impostorPasses.Get(tangentDefines);
+                    impostorPass.Use();
+                    glActiveTexture(GL_TEXTURE0);
+                    glBindTexture(GL_TEXTURE_2D, impostorAtlas.GetTexture(GL_COLOR_ATTACHMENT0));
+                    glActiveTexture(GL_TEXTURE1);
+                    glBindTexture(GL_TEXTURE_2D, impostorAtlas.GetTexture(GL_COLOR_ATTACHMENT1));
+                    glActiveTexture(GL_TEXTURE2);
+                    glBindTexture(GL_TEXTURE_2D, impostorAtlas.GetTexture(GL_COLOR_ATTACHMENT2));
+                    glActiveTexture(GL_TEXTURE3);
+                    glBindTexture(GL_TEXTURE_2D, impostorAtlas.GetTexture(GL_DEPTH_ATTACHMENT));
+                    impostorPass.SetUniform("impostorNormal", 0);
+                    impostorPass.SetUniform("impostorAlbedo", 1);
+                    impostorPass.SetUniform("impostorTangent", 2);
+                    impostorPass.SetUniform("impostorDepth", 3);
+                    impostorPass.SetUniform("impostorViews", IMPOSTOR_VIEWS);
+                    impostorPass.SetUniform("impostorCenter", objectPos);
+                    impostorPass.SetUniform("impostorRadius", FUR_BOUNDS_RADIUS);
+                    impostorPass.SetUniform("projection", projection);
+                    impostorPass.SetUniform("view", view);
+                    impostorPass.SetUniform("viewPos", camera.GetPosition());
+                    RenderQuad(); })
+                    .WriteAttachment(gNormal, GL_COLOR_ATTACHMENT0, LoadOp::DontCare)
+                    .WriteAttachment(gAlbedoSpec, GL_COLOR_ATTACHMENT1, albedoLoad)
+                    .WriteAttachment(gDepth, GL_DEPTH_ATTACHMENT, LoadOp::Clear);
+                if (gTangent.IsValid())
+                    impostor.WriteAttachment(gTangent, GL_COLOR_ATTACHMENT2, LoadOp::DontCare);
+            }
+            else if (furCompute)
+            {
+                // 2. Compute fur pass: rasterize the rays, then march them tile by tile into the gAlbedoSpec image
+                RenderResource furRays = renderGraph.Create("fur rays", {furWidth, furHeight, GL_RGBA32F});
+                RenderPass &rays = renderGraph.AddPass("fur rays", [&]()
+                                    {
+                    GLShader &rayPass = furGeometryPasses.Get(std::string("#define RAY_ATTRIBUTES\n") + (animateFur ? skinnedDefines : "") + tangentDefines);
+                    rayPass.Use();
+                    rayPass.SetUniform("projection", projection);
+                    rayPass.SetUniform("view", view);
+                    rayPass.SetUniform("viewPos", camera.GetPosition());
+                    drawFurGeometry(rayPass, furModel, furDrawList, sphereMeshlets); })
+                    .WriteAttachment(gNormal, GL_COLOR_ATTACHMENT0, LoadOp::DontCare)
+                    .WriteAttachment(furRays, GL_COLOR_ATTACHMENT1, LoadOp::DontCare)
+                    .WriteAttachment(gDepth, GL_DEPTH_ATTACHMENT, LoadOp::Clear);
+                if (gTangent.IsValid())
+                    rays.WriteAttachment(gTangent, GL_COLOR_ATTACHMENT2, LoadOp::DontCare);
+                // the march writes every pixel, covered or not
+                renderGraph.AddPass("fur march", [&, furRays]()
+                                    {
+                    glActiveTexture(GL_TEXTURE0);
+                    glBindTexture(GL_TEXTURE_2D, renderGraph.GetTexture(furRays));
+                    glActiveTexture(GL_TEXTURE1);
+                    glBindTexture(GL_TEXTURE_2D, renderGraph.GetTexture(gDepth));
+                    glActiveTexture(GL_TEXTURE2);
+                    glBindTexture(GL_TEXTURE_2D, diffuseTex);
+                    glActiveTexture(GL_TEXTURE3);
+                    glBindTexture(GL_TEXTURE_2D, noiseTex);
+                    glBindImageTextureExt(0, renderGraph.GetTexture(gAlbedoSpec), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+                    // the same layer count as the fragment reference march
+                    std::string marchDefines;
+                    if (furSampleCount < FUR_REFERENCE_SAMPLES)
+                        marchDefines = "#define SAMPLE_COUNT " + std::to_string(furSampleCount) + "\n";
+                    GLComputeShader &marchPass = furComputePasses.GetCompute(marchDefines);
+                    marchPass.Use();
+                    marchPass.SetUniform("furRays", 0);
+                    marchPass.SetUniform("rayDepth", 1);
+                    marchPass.SetUniform("texture_diffuse", 2);
+                    marchPass.SetUniform("texture_noise", 3);
+                    marchPass.SetUniform("gAlbedoSpec", 0);
+                    marchPass.Dispatch((furWidth + FUR_COMPUTE_TILE - 1) / FUR_COMPUTE_TILE, (furHeight + FUR_COMPUTE_TILE - 1) / FUR_COMPUTE_TILE);
+                    glMemoryBarrierExt(GL_TEXTURE_FETCH_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT); })
+                    .Read(furRays)
+                    .Read(gDepth)
+                    .Write(gAlbedoSpec);
+            }
+            else
+            {
+                RenderPass &geometry = renderGraph.AddPass("fur geometry", [&]()
+                                    {
+                    // 2. Geometry Pass
+                    if (depthPrepass)
+                    {
+                        // depth is final; only the nearest fragment of each pixel passes and runs the march
+                        glDepthFunc(GL_EQUAL);
+                        glDepthMask(GL_FALSE);
+                    }
+                    glActiveTexture(GL_TEXTURE0);
+                    glBindTexture(GL_TEXTURE_2D, diffuseTex);
+                    glActiveTexture(GL_TEXTURE1);
+                    glBindTexture(GL_TEXTURE_2D, noiseTex);
+                    glActiveTexture(GL_TEXTURE2);
+                    glBindTexture(GL_TEXTURE_2D, renderGraph.GetTexture(baseDepth));
+                    std::string furDefines = animateFur ? skinnedDefines : "";
+                    furDefines += FUR_MARCH_MODE_DEFINES[(int)furMarchMode];
+                    if (edgeDistance.IsValid())
+                        furDefines += "#define EDGE_DISSOLVE\n";
+                    if (checkerboard)
+                        furDefines += "#define CHECKERBOARD\n";
+                    if (halfPrecisionFur)
+                        furDefines += "#define HALF_PRECISION\n";
+                    if (furSampleCount < FUR_REFERENCE_SAMPLES)
+                        furDefines += "#define SAMPLE_COUNT " + std::to_string(furSampleCount) + "\n";
+                    furDefines += tangentDefines;
+                    GLShader &geometryPass = furGeometryPasses.Get(furDefines);
+                    geometryPass.Use();
+                    geometryPass.SetUniform("projection", projection);
+                    geometryPass.SetUniform("view", view);
+                    geometryPass.SetUniform("texture_diffuse", 0);
+                    geometryPass.SetUniform("texture_noise", 1);
+                    geometryPass.SetUniform("texture_baseDepth", 2);
+                    geometryPass.SetUniform("viewPos", camera.GetPosition());
+                    geometryPass.SetUniform("minSampleCount", FUR_MIN_SAMPLES);
+                    geometryPass.SetUniform("maxSampleCount", std::min(FUR_MAX_SAMPLES, furSampleCount));
+                    if (furMarchMode == FurMarchMode::Hierarchical)
+                    {
+                        glActiveTexture(GL_TEXTURE3);
+                        glBindTexture(GL_TEXTURE_2D, maxHeightTex);
+                        geometryPass.SetUniform("texture_maxHeight", 3);
+                        geometryPass.SetUniform("maxHeightLevels", FUR_PYRAMID_LEVELS);
+                    }
+                    else if (furMarchMode == FurMarchMode::ConeStep)
+                    {
+                        glActiveTexture(GL_TEXTURE3);
+                        glBindTexture(GL_TEXTURE_2D, coneStepMap.texture);
+                        geometryPass.SetUniform("texture_cone", 3);
+                        geometryPass.SetUniform("coneScale", coneStepMap.coneScale);
+                    }
+                    else if (furMarchMode == FurMarchMode::Refined)
+                    {
+                        geometryPass.SetUniform("coarseSampleCount", FUR_COARSE_SAMPLES);
+                        geometryPass.SetUniform("refineSteps", FUR_REFINE_STEPS);
+                    }
+                    else if (temporalFur)
+                    {
+                        // bit-reversed order, so every pair of consecutive frames already spreads its layers evenly
+                        const float jitter[FUR_TEMPORAL_STRIDE] = {0.0f, 0.5f, 0.25f, 0.75f};
+                        geometryPass.SetUniform("temporalStride", FUR_TEMPORAL_STRIDE);
+                        geometryPass.SetUniform("layerJitter", jitter[frameIndex % FUR_TEMPORAL_STRIDE]);
+                    }
+                    if (checkerboard)
+                        geometryPass.SetUniform("checkerParity", (int)(frameIndex & 1));
+                    if (edgeDistance.IsValid())
+                    {
+                        glActiveTexture(GL_TEXTURE4);
+                        glBindTexture(GL_TEXTURE_2D, renderGraph.GetTexture(edgeDistance));
+                        geometryPass.SetUniform("texture_edgeDistance", 4);
+                        geometryPass.SetUniform("furResolution", glm::vec2((float)furWidth, (float)furHeight));
+                        geometryPass.SetUniform("edgeDissolveWidth", EDGE_DISSOLVE_WIDTH);
+                    }
+                    drawVisibleFur(geometryPass);
+                    glDepthFunc(GL_LESS);
+                    glDepthMask(GL_TRUE); })
+                    .Read(baseDepth)
+                    .WriteAttachment(gNormal, GL_COLOR_ATTACHMENT0, LoadOp::DontCare)
+                    .WriteAttachment(gAlbedoSpec, GL_COLOR_ATTACHMENT1, albedoLoad)
+                    .WriteAttachment(gDepth, GL_DEPTH_ATTACHMENT, depthPrepass ? LoadOp::Load : LoadOp::Clear);
+                if (edgeDistance.IsValid())
+                    geometry.Read(edgeDistance);
+                if (gTangent.IsValid())
+                    geometry.WriteAttachment(gTangent, GL_COLOR_ATTACHMENT2, LoadOp::DontCare);
+            }
+
+            if (furResolve)
+            {
+                TextureDesc albedoDesc = {furWidth, furHeight, GL_RGBA16F, GL_LINEAR};
+                TextureDesc depthDesc = {furWidth, furHeight, GL_RG32F};
+                TextureDesc normalDesc = {furWidth, furHeight, GL_RG16};
+                RenderResource previousAlbedo = renderGraph.Import("previous albedo", historyRead.GetTexture(GL_COLOR_ATTACHMENT0), albedoDesc);
+                RenderResource previousDepth = renderGraph.Import("previous depth", historyRead.GetTexture(GL_COLOR_ATTACHMENT1), depthDesc);
+                RenderResource previousNormal = renderGraph.Import("previous normal", historyRead.GetTexture(GL_COLOR_ATTACHMENT2), normalDesc);
+                RenderResource historyAlbedo = renderGraph.Import("history albedo", historyWrite.GetTexture(GL_COLOR_ATTACHMENT0), albedoDesc);
+                RenderResource historyDepth = renderGraph.Import("history depth", historyWrite.GetTexture(GL_COLOR_ATTACHMENT1), depthDesc);
+                RenderResource historyNormal = renderGraph.Import("history normal", historyWrite.GetTexture(GL_COLOR_ATTACHMENT2), normalDesc);
+                renderGraph.AddPass(temporalFur ? "temporal resolve" : "checkerboard reconstruction", [&, previousAlbedo, previousDepth, previousNormal]()
+                                    {
+                    // 2.5 Temporal resolve: blend this frame's layer subset into the reprojected history, or
+                    // checkerboard reconstruction: fill the pixels the fur pass skipped from history and neighbours
+                    GLShader &resolvePass = temporalFur ? shaderTemporalResolve : shaderCheckerboardResolve;
+                    resolvePass.Use();
+                    glActiveTexture(GL_TEXTURE0);
+                    glBindTexture(GL_TEXTURE_2D, renderGraph.GetTexture(gDepth));
+                    glActiveTexture(GL_TEXTURE1);
+                    glBindTexture(GL_TEXTURE_2D, renderGraph.GetTexture(gNormal));
+                    glActiveTexture(GL_TEXTURE2);
+                    glBindTexture(GL_TEXTURE_2D, renderGraph.GetTexture(gAlbedoSpec));
+                    glActiveTexture(GL_TEXTURE3);
+                    glBindTexture(GL_TEXTURE_2D, renderGraph.GetTexture(previousAlbedo));
+                    glActiveTexture(GL_TEXTURE4);
+                    glBindTexture(GL_TEXTURE_2D, renderGraph.GetTexture(previousDepth));
+                    glActiveTexture(GL_TEXTURE5);
+                    glBindTexture(GL_TEXTURE_2D, renderGraph.GetTexture(previousNormal));
+                    resolvePass.SetUniform("gDepth", 0);
+                    resolvePass.SetUniform("gNormal", 1);
+                    resolvePass.SetUniform("gAlbedoSpec", 2);
+                    resolvePass.SetUniform("previousAlbedo", 3);
+                    resolvePass.SetUniform("previousDepth", 4);
+                    resolvePass.SetUniform("previousNormal", 5);
+                    resolvePass.SetUniform("inverseViewProjection", glm::inverse(projection * view));
+                    resolvePass.SetUniform("previousViewProjection", camera.GetPreviousViewProjection());
+                    resolvePass.SetUniform("inversePreviousViewProjection", glm::inverse(camera.GetPreviousViewProjection()));
+                    resolvePass.SetUniform("viewPos", camera.GetPosition());
+                    if (temporalFur)
+                        resolvePass.SetUniform("maxHistory", FUR_TEMPORAL_MAX_HISTORY);
+                    else
+                        resolvePass.SetUniform("checkerParity", (int)(frameIndex & 1));
+                    RenderQuad(); })
+                    .Read(gDepth)
+                    .Read(gNormal)
+                    .Read(gAlbedoSpec)
+                    .Read(previousAlbedo)
+                    .Read(previousDepth)
+                    .Read(previousNormal)
+                    .WriteAttachment(historyAlbedo, GL_COLOR_ATTACHMENT0, LoadOp::DontCare)
+                    .WriteAttachment(historyDepth, GL_COLOR_ATTACHMENT1, LoadOp::DontCare)
+                    .WriteAttachment(historyNormal, GL_COLOR_ATTACHMENT2, LoadOp::DontCare);
+                lightingAlbedo = historyAlbedo;
+            }
+        }
+
+        // screen tiles the fur objects may cover, the only ones the lighting pass shades
+        std::vector<ScreenRect> objectRects;
+        if (furVisible)
+            objectRects.push_back(furRect);
+        std::vector<ScreenRect> litTiles = ClassifyTiles(objectRects, framebufferWidth, framebufferHeight);
+
+        RenderPass &lighting = renderGraph.AddPass("lighting", [&]()
+                                                   {
+            // 3. Lighting Pass: the backbuffer is cleared, then only the covered tiles are shaded, without depth test
+            glDisable(GL_DEPTH_TEST);
+            std::string lightingDefines = reducedFur ? "#define UPSAMPLE\n" : "";
+            if (clusteredLights)
+                lightingDefines += "#define CLUSTERED_LIGHTS\n";
+            if (kajiyaKayShading)
+                lightingDefines += "#define KAJIYA_KAY\n";
+            GLShader &lightingPass = lightingPasses.Get(lightingDefines);
+            lightingPass.Use();
             glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, gPosition);
+            glBindTexture(GL_TEXTURE_2D, renderGraph.GetTexture(reducedFur ? prepassDepth : gDepth));
             glActiveTexture(GL_TEXTURE1);
-            glBindTexture(GL_TEXTURE_2D, gNormal);
+            glBindTexture(GL_TEXTURE_2D, renderGraph.GetTexture(gNormal));
             glActiveTexture(GL_TEXTURE2);
-            glBindTexture(GL_TEXTURE_2D, gAlbedoSpec);
-            shaderLightingPass.SetUniform("gPosition", 0);
-            shaderLightingPass.SetUniform("gNormal", 1);
-            shaderLightingPass.SetUniform("gAlbedoSpec", 2);
-            shaderLightingPass.SetUniform("lightPos", lightPos);
-            shaderLightingPass.SetUniform("viewPos", camera.GetPosition());
-            // Finally render quad
-            RenderQuad();
-        }
+            glBindTexture(GL_TEXTURE_2D, renderGraph.GetTexture(lightingAlbedo));
+            lightingPass.SetUniform("gDepth", 0);
+            lightingPass.SetUniform("gNormal", 1);
+            lightingPass.SetUniform("gAlbedoSpec", 2);
+            if (kajiyaKayShading)
+            {
+                glActiveTexture(GL_TEXTURE8);
+                glBindTexture(GL_TEXTURE_2D, renderGraph.GetTexture(gTangent));
+                glActiveTexture(GL_TEXTURE9);
+                glBindTexture(GL_TEXTURE_2D, kajiyaKayLut);
+                lightingPass.SetUniform("gTangent", 8);
+                lightingPass.SetUniform("kajiyaKayLut", 9);
+            }
+            if (reducedFur)
+            {
+                glActiveTexture(GL_TEXTURE3);
+                glBindTexture(GL_TEXTURE_2D, renderGraph.GetTexture(gDepth));
+                glActiveTexture(GL_TEXTURE4);
+                glBindTexture(GL_TEXTURE_2D, renderGraph.GetTexture(prepassNormal));
+                lightingPass.SetUniform("gDepthLow", 3);
+                lightingPass.SetUniform("gNormalFull", 4);
+                lightingPass.SetUniform("lowResolution", glm::vec2((float)furWidth, (float)furHeight));
+                lightingPass.SetUniform("projection", projection);
+            }
+            if (clusteredLights)
+            {
+                lightClusters.Bind(lightingPass, 5);
+                lightingPass.SetUniform("view", view);
+            }
+            lightingPass.SetUniform("inverseViewProjection", glm::inverse(projection * view));
+            lightingPass.SetUniform("lightPos", lightPos);
+            lightingPass.SetUniform("viewPos", camera.GetPosition());
+            // Finally render quad, scissored to each covered rectangle
+            glEnable(GL_SCISSOR_TEST);
+            for (const ScreenRect &rect : litTiles)
+            {
+                glScissor(rect.x, rect.y, rect.width, rect.height);
+                RenderQuad();
+            }
+            glDisable(GL_SCISSOR_TEST);
+            glEnable(GL_DEPTH_TEST); });
+        lighting.Read(gDepth).Read(gNormal).Read(lightingAlbedo).WriteBackbuffer(framebufferWidth, framebufferHeight, LoadOp::Clear);
+        if (reducedFur)
+            lighting.Read(prepassDepth).Read(prepassNormal);
+        if (gTangent.IsValid())
+            lighting.Read(gTangent);
+
+        renderGraph.Execute();
 
         glfwSwapBuffers(window);
+        renderTargetPool.EndFrame();
+        // the history ping-pong and the per-frame patterns only advance with the fur passes
+        if (geometryDirty)
+            ++frameIndex;
+
+        // frames that only relight say nothing about the cost of the fur, and the benchmark measures fixed settings
+        if (frameGovernor && geometryDirty && benchmarkFrame < 0 && governor.Update(renderGraph.GetFrameMilliseconds()))
+        {
+            renderScale = governor.GetQuality().renderScale;
+            furSampleCount = governor.GetQuality().furSampleCount;
+            std::cout << "Quality level " << governor.GetLevel() << "/" << governor.GetLevelCount() - 1 << ": render scale " << renderScale
+                      << ", " << furSampleCount << " fur layers (GPU " << governor.GetSmoothedMilliseconds() << " ms)" << std::endl;
+        }
+        if (currentFrame - lastTelemetryTime > 0.5)
+        {
+            // telemetry: quality level, GPU time of the last frame and of its fur geometry pass, e.g. to compare modes
+            lastTelemetryTime = currentFrame;
+            char title[192];
+            std::snprintf(title, sizeof(title), "FurRenderingShader - quality %d/%d%s, scale %.2f, %d layers, GPU %.1f ms, fur pass %.2f ms",
+                          governor.GetLevel(), governor.GetLevelCount() - 1, frameGovernor ? "" : " (fixed)", renderScale, furSampleCount,
+                          renderGraph.GetFrameMilliseconds(), renderGraph.GetPassTimer("fur geometry").GetMilliseconds());
+            glfwSetWindowTitle(window, title);
+        }
+        if (benchmarkFrame >= 0 && ++benchmarkFrame == 2 * (BENCHMARK_WARMUP + BENCHMARK_FRAMES) + 8)
+        {
+            // the extra frames drain the queries still in flight
+            auto averageMilliseconds = [&](const char *const(&passes)[2])
+            {
+                double milliseconds = 0.0;
+                for (const char *pass : passes)
+                    milliseconds += renderGraph.GetPassTimer(pass).GetAverageMilliseconds();
+                return milliseconds;
+            };
+            std::cout << "Fur pass benchmark (reference march, " << furSampleCount << " layers) at " << furWidth << "x" << furHeight << ": fragment " << averageMilliseconds(fragmentFurPasses) << " ms";
+            if (furComputeAvailable)
+                std::cout << ", compute " << averageMilliseconds(computeFurPasses) << " ms";
+            else
+                std::cout << ", compute path unavailable (needs GL 4.3)";
+            std::cout << " (" << renderGraph.GetPassTimer("fur geometry").GetResultCount() << " frames each)" << std::endl;
+            benchmarkFrame = -1;
+            computeFur = false;
+            furMarchMode = benchmarkMarchMode;
+            halfPrecisionFur = benchmarkHalfPrecision;
+            furSampleCount = benchmarkSampleCount;
+            renderScale = benchmarkRenderScale;
+            if (benchmarkAndExit)
+                glfwSetWindowShouldClose(window, true);
+        }
     }
 
     glfwTerminate();
     return 0;
 }
 
+void WindowRefreshCallback(GLFWwindow *window)
+{
+    windowDamaged = true;
+}
+
 void MouseCallback(GLFWwindow *window, double xposIn, double yposIn)
 {
     float xpos = static_cast<float>(xposIn);
@@ -245,3 +1034,88 @@ void MouseScrollCallback(GLFWwindow *window, double xoffset, double yoffset)
 {
     camera.ProcessMouseScroll(static_cast<float>(yoffset));
 }
+
+void KeyCallback(GLFWwindow *window, int key, int scancode, int action, int mods)
+{
+    if (action != GLFW_PRESS)
+        return;
+    switch (key)
+    {
+    case GLFW_KEY_K:
+        animateFur = !animateFur;
+        std::cout << "Animated creature: " << (animateFur ? "on" : "off") << std::endl;
+        break;
+    case GLFW_KEY_MINUS:
+    case GLFW_KEY_EQUAL:
+        renderScale = glm::clamp(renderScale + (key == GLFW_KEY_EQUAL ? 0.25f : -0.25f), 0.25f, 2.0f);
+        std::cout << "Render scale: " << renderScale << std::endl;
+        if (frameGovernor)
+        {
+            frameGovernor = false;
+            std::cout << "Frame-time governor: off" << std::endl;
+        }
+        break;
+    case GLFW_KEY_G:
+        frameGovernor = !frameGovernor;
+        std::cout << "Frame-time governor: " << (frameGovernor ? "on" : "off") << std::endl;
+        break;
+    case GLFW_KEY_R:
+        furAreaScale = furAreaScale == 1.0f ? 0.5f : (furAreaScale == 0.5f ? 0.25f : 1.0f);
+        std::cout << "Fur pass area: " << furAreaScale << std::endl;
+        break;
+    case GLFW_KEY_P:
+        furDepthPrepass = !furDepthPrepass;
+        std::cout << "Fur depth prepass: " << (furDepthPrepass ? "on" : "off") << std::endl;
+        break;
+    case GLFW_KEY_C:
+        computeFur = !computeFur;
+        std::cout << "Fur pass: " << (computeFur ? "compute (if GL 4.3 is available, reference march at full precision only)" : "fragment") << std::endl;
+        break;
+    case GLFW_KEY_B:
+        if (benchmarkFrame < 0)
+        {
+            benchmarkFrame = 0;
+            std::cout << "Benchmarking the fur pass..." << std::endl;
+        }
+        break;
+    case GLFW_KEY_L:
+        clusteredLights = !clusteredLights;
+        std::cout << "Clustered lights: " << (clusteredLights ? std::to_string(clusteredLightCount) : "off") << std::endl;
+        break;
+    case GLFW_KEY_LEFT_BRACKET:
+    case GLFW_KEY_RIGHT_BRACKET:
+        clusteredLightCount = glm::clamp(clusteredLightCount + (key == GLFW_KEY_RIGHT_BRACKET ? 100 : -100), CLUSTERED_LIGHTS_MIN, CLUSTERED_LIGHTS_MAX);
+        std::cout << "Clustered light count: " << clusteredLightCount << std::endl;
+        break;
+    case GLFW_KEY_E:
+        edgeDissolve = !edgeDissolve;
+        std::cout << "Edge dissolve: " << (edgeDissolve ? "on" : "off") << std::endl;
+        break;
+    case GLFW_KEY_H:
+        kajiyaKayShading = !kajiyaKayShading;
+        std::cout << "Fur shading: " << (kajiyaKayShading ? "Kajiya-Kay" : "Lambert") << std::endl;
+        break;
+    case GLFW_KEY_O:
+        furOcclusionCulling = !furOcclusionCulling;
+        std::cout << "Fur occlusion culling: " << (furOcclusionCulling ? "on" : "off") << std::endl;
+        break;
+    case GLFW_KEY_I:
+        furImpostors = !furImpostors;
+        std::cout << "Fur impostors: " << (furImpostors ? "on" : "off") << std::endl;
+        break;
+    case GLFW_KEY_X:
+        checkerboardFur = !checkerboardFur;
+        std::cout << "Checkerboard fur: " << (checkerboardFur ? "on" : "off") << std::endl;
+        break;
+    case GLFW_KEY_F:
+        halfPrecisionFur = !halfPrecisionFur;
+        std::cout << "Fur march precision: " << (halfPrecisionFur ? "half" : "full") << std::endl;
+        break;
+    case GLFW_KEY_M:
+        furMarchMode = (FurMarchMode)(((int)furMarchMode + 1) % (int)FurMarchMode::Count);
+        std::cout << "Fur march: " << FUR_MARCH_MODE_NAMES[(int)furMarchMode] << std::endl;
+        break;
+    default:
+        break;
+    }
+}
@@ -0,0 +1,191 @@
+#include "meshlet.h"
+#include "parallel.h"
+#include <algorithm>
+#include <climits>
+#include <map>
+
+static glm::vec3 GetVertexAttribute(const std::vector<float> &vertices, GLuint vertex, GLuint offset)
+{
+    const float *v = &vertices[vertex * GeometryArena::GetVertexSize(VertexFormat::Mesh) + offset];
+    return glm::vec3(v[0], v[1], v[2]);
+}
+
+static Meshlet ComputeMeshletBounds(const std::vector<float> &vertices, const std::vector<GLuint> &meshletVertices,
+                                    const std::vector<GLuint> &indices, GLuint firstIndex, GLuint indexCount)
+{
+    Meshlet meshlet;
+    meshlet.firstIndex = firstIndex;
+    meshlet.indexCount = indexCount;
+
+    // bounding sphere around the vertex centroid
+    glm::vec3 center(0.0f);
+    for (GLuint v : meshletVertices)
+        center += GetVertexAttribute(vertices, v, 0);
+    center /= (float)meshletVertices.size();
+    float radius = 0.0f;
+    for (GLuint v : meshletVertices)
+        radius = std::max(radius, glm::length(GetVertexAttribute(vertices, v, 0) - center));
+    meshlet.center = center;
+    meshlet.radius = radius;
+
+    // normal cone; triangle normals are oriented by the shading normals so the result does not depend on winding
+    std::vector<glm::vec3> normals;
+    glm::vec3 axis(0.0f);
+    for (GLuint i = firstIndex; i < firstIndex + indexCount; i += 3)
+    {
+        glm::vec3 a = GetVertexAttribute(vertices, indices[i], 0);
+        glm::vec3 b = GetVertexAttribute(vertices, indices[i + 1], 0);
+        glm::vec3 c = GetVertexAttribute(vertices, indices[i + 2], 0);
+        glm::vec3 n = glm::normalize(glm::cross(b - a, c - a));
+        glm::vec3 shading = GetVertexAttribute(vertices, indices[i], 3) + GetVertexAttribute(vertices, indices[i + 1], 3) + GetVertexAttribute(vertices, indices[i + 2], 3);
+        if (glm::dot(n, shading) < 0.0f)
+            n = -n;
+        normals.push_back(n);
+        axis += n;
+    }
+    meshlet.coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+    meshlet.coneCutoff = 1.0f;
+    if (glm::length(axis) > 1e-6f)
+    {
+        axis = glm::normalize(axis);
+        float minDot = 1.0f;
+        for (const auto &n : normals)
+            minDot = std::min(minDot, glm::dot(n, axis));
+        meshlet.coneAxis = axis;
+        // cones wider than ~84 degrees are not worth testing
+        if (minDot > 0.1f)
+            meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+    }
+    return meshlet;
+}
+
+MeshletMesh LoadMeshletMesh(const std::vector<float> &vertices, const std::vector<GLuint> &triangles)
+{
+    MeshletMesh result;
+    size_t vertexCount = vertices.size() / GeometryArena::GetVertexSize(VertexFormat::Mesh);
+    std::vector<GLuint> ordered;
+    ordered.reserve(triangles.size());
+    std::vector<GLuint> owner(vertexCount, UINT_MAX);
+    std::vector<GLuint> meshletVertices;
+    meshletVertices.reserve(MESHLET_MAX_VERTICES);
+    GLuint firstIndex = 0;
+
+    auto flush = [&]()
+    {
+        GLuint indexCount = static_cast<GLuint>(ordered.size()) - firstIndex;
+        if (indexCount == 0)
+            return;
+        result.meshlets.push_back(ComputeMeshletBounds(vertices, meshletVertices, ordered, firstIndex, indexCount));
+        firstIndex = static_cast<GLuint>(ordered.size());
+        meshletVertices.clear();
+    };
+
+    // greedy partition in index order, which is spatially coherent for our generated and loaded meshes
+    for (size_t t = 0; t + 2 < triangles.size(); t += 3)
+    {
+        const GLuint tri[3] = {triangles[t], triangles[t + 1], triangles[t + 2]};
+        glm::vec3 a = GetVertexAttribute(vertices, tri[0], 0);
+        glm::vec3 b = GetVertexAttribute(vertices, tri[1], 0);
+        glm::vec3 c = GetVertexAttribute(vertices, tri[2], 0);
+        if (glm::length(glm::cross(b - a, c - a)) < 1e-12f)
+            continue;
+
+        GLuint id = static_cast<GLuint>(result.meshlets.size());
+        GLuint newVertices = 0;
+        for (GLuint v : tri)
+            newVertices += owner[v] != id ? 1 : 0;
+        GLuint triangleCount = (static_cast<GLuint>(ordered.size()) - firstIndex) / 3;
+        if (meshletVertices.size() + newVertices > MESHLET_MAX_VERTICES || triangleCount + 1 > MESHLET_MAX_TRIANGLES)
+        {
+            flush();
+            id = static_cast<GLuint>(result.meshlets.size());
+        }
+        for (GLuint v : tri)
+        {
+            if (owner[v] != id)
+            {
+                owner[v] = id;
+                meshletVertices.push_back(v);
+            }
+            ordered.push_back(v);
+        }
+    }
+    flush();
+
+    result.mesh = GeometryArena::Instance().Allocate(VertexFormat::Mesh, GL_TRIANGLES, vertices, ordered);
+    return result;
+}
+
+size_t CullMeshlets(const MeshletMesh &mesh, const glm::mat4 &model, const glm::mat4 &viewProjection, const glm::vec3 &cameraPos, DrawList &drawList)
+{
+    // frustum planes and camera in object space, so the meshlet bounds can be tested untransformed
+    glm::mat4 m = viewProjection * model;
+    glm::vec4 planes[6];
+    for (int i = 0; i < 3; ++i)
+    {
+        glm::vec4 row(m[0][i], m[1][i], m[2][i], m[3][i]);
+        glm::vec4 w(m[0][3], m[1][3], m[2][3], m[3][3]);
+        planes[i * 2] = w + row;
+        planes[i * 2 + 1] = w - row;
+    }
+    for (auto &plane : planes)
+        plane /= glm::length(glm::vec3(plane.x, plane.y, plane.z));
+    glm::vec4 eye = glm::inverse(model) * glm::vec4(cameraPos, 1.0f);
+    glm::vec3 eyePos(eye.x, eye.y, eye.z);
+
+    const std::vector<Meshlet> &meshlets = mesh.meshlets;
+    std::vector<unsigned char> visible(meshlets.size());
+    ParallelFor(meshlets.size(), 64, [&](size_t begin, size_t end)
+                {
+        for (size_t i = begin; i < end; ++i)
+        {
+            const Meshlet &meshlet = meshlets[i];
+            bool inside = true;
+            for (const auto &plane : planes)
+            {
+                if (glm::dot(glm::vec3(plane.x, plane.y, plane.z), meshlet.center) + plane.w < -meshlet.radius)
+                {
+                    inside = false;
+                    break;
+                }
+            }
+            glm::vec3 toCenter = meshlet.center - eyePos;
+            bool backFacing = glm::dot(toCenter, meshlet.coneAxis) >= meshlet.coneCutoff * glm::length(toCenter) + meshlet.radius;
+            visible[i] = inside && !backFacing;
+        } });
+
+    size_t visibleCount = 0;
+    size_t i = 0;
+    while (i < meshlets.size())
+    {
+        if (!visible[i])
+        {
+            ++i;
+            continue;
+        }
+        GLuint first = meshlets[i].firstIndex;
+        GLuint count = 0;
+        while (i < meshlets.size() && visible[i])
+        {
+            count += meshlets[i].indexCount;
+            ++visibleCount;
+            ++i;
+        }
+        drawList.AddRange(mesh.mesh, first, count);
+    }
+    return visibleCount;
+}
+
+const MeshletMesh &GetSphereMeshlets(unsigned int segments)
+{
+    static std::map<unsigned int, MeshletMesh> spheres;
+    MeshletMesh &sphere = spheres[segments];
+    if (sphere.meshlets.empty())
+    {
+        std::vector<float> vertices;
+        std::vector<GLuint> strip;
+        GenerateSphere(vertices, strip, segments);
+        sphere = LoadMeshletMesh(vertices, StripToTriangles(strip));
+    }
+    return sphere;
+}
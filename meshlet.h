@@ -0,0 +1,36 @@
+#pragma once
+#include "geometry.h"
+
+constexpr GLuint MESHLET_MAX_VERTICES = 64;
+constexpr GLuint MESHLET_MAX_TRIANGLES = 124;
+
+// A cluster of up to MESHLET_MAX_TRIANGLES triangles referencing at most MESHLET_MAX_VERTICES vertices.
+// Bounds are in object space.
+struct Meshlet
+{
+    glm::vec3 center;
+    float radius;
+    glm::vec3 coneAxis;
+    // sine of the cone half angle widened by 90 degrees; 1 disables backface culling for this meshlet
+    float coneCutoff;
+    GLuint firstIndex;
+    GLuint indexCount;
+};
+
+// Triangle-list mesh whose index buffer is ordered meshlet by meshlet.
+struct MeshletMesh
+{
+    MeshHandle mesh;
+    std::vector<Meshlet> meshlets;
+};
+
+// Splits a triangle list (Mesh vertex format) into meshlets and uploads it into the geometry arena.
+MeshletMesh LoadMeshletMesh(const std::vector<float> &vertices, const std::vector<GLuint> &triangles);
+
+// Culls meshlets that are back-facing or outside the view frustum on the worker threads and appends the
+// index ranges of the survivors to drawList. Adjacent visible meshlets are merged into one range.
+// Returns the number of visible meshlets.
+size_t CullMeshlets(const MeshletMesh &mesh, const glm::mat4 &model, const glm::mat4 &viewProjection, const glm::vec3 &cameraPos, DrawList &drawList);
+
+// segments controls the tessellation, lower values give cheaper LODs for coarse passes
+const MeshletMesh &GetSphereMeshlets(unsigned int segments = 64);
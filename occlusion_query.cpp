@@ -0,0 +1,41 @@
+#include "occlusion_query.h"
+
+OcclusionQuery::~OcclusionQuery()
+{
+    if (m_queries[0] != 0)
+        glDeleteQueries(2, m_queries);
+}
+
+void OcclusionQuery::NewFrame()
+{
+    m_previous = m_current;
+    m_current = -1;
+}
+
+void OcclusionQuery::Begin()
+{
+    if (m_queries[0] == 0)
+        glGenQueries(2, m_queries);
+    m_current = m_previous == 0 ? 1 : 0;
+    glBeginQuery(GL_ANY_SAMPLES_PASSED, m_queries[m_current]);
+}
+
+void OcclusionQuery::End()
+{
+    glEndQuery(GL_ANY_SAMPLES_PASSED);
+}
+
+void OcclusionQuery::BeginConditionalRender()
+{
+    m_conditional = m_previous >= 0;
+    // NO_WAIT: should the result still be missing, the GPU draws rather than stalls
+    if (m_conditional)
+        glBeginConditionalRender(m_queries[m_previous], GL_QUERY_NO_WAIT);
+}
+
+void OcclusionQuery::EndConditionalRender()
+{
+    if (m_conditional)
+        glEndConditionalRender();
+    m_conditional = false;
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include "utils.h"
+
+// Visibility of an object from a GL_ANY_SAMPLES_PASSED query around its cheap draw, used to skip its expensive
+// draws with conditional rendering. The condition is the query of the previous frame, which the GPU has long
+// finished, so conditional draws never wait on it; an object coming into view misses its expensive draws for
+// one frame. Call NewFrame once per frame before the query; frames without a previous query draw unconditionally.
+class OcclusionQuery
+{
+private:
+    GLuint m_queries[2] = {};
+    // slot written by the query of this frame, and the slot of the previous frame that the condition reads
+    int m_current = -1;
+    int m_previous = -1;
+    bool m_conditional = false;
+
+public:
+    OcclusionQuery() = default;
+    OcclusionQuery(const OcclusionQuery &) = delete;
+    OcclusionQuery &operator=(const OcclusionQuery &) = delete;
+    ~OcclusionQuery();
+
+    void NewFrame();
+    // counts the samples of the draws in between
+    void Begin();
+    void End();
+    // draws in between are discarded by the GPU when the previous frame's query saw no samples
+    void BeginConditionalRender();
+    void EndConditionalRender();
+};
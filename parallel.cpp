@@ -0,0 +1,100 @@
+#include "parallel.h"
+#include <algorithm>
+
+static thread_local bool insideJob = false;
+
+WorkerPool::WorkerPool(unsigned threadCount)
+{
+    if (threadCount == 0)
+    {
+        unsigned hardware = std::thread::hardware_concurrency();
+        threadCount = hardware > 1 ? hardware - 1 : 0;
+    }
+    for (unsigned i = 0; i < threadCount; ++i)
+    {
+        m_threads.emplace_back(&WorkerPool::WorkerLoop, this);
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    m_wake.notify_all();
+    for (auto &thread : m_threads)
+        thread.join();
+}
+
+WorkerPool &WorkerPool::Instance()
+{
+    static WorkerPool pool;
+    return pool;
+}
+
+void WorkerPool::RunChunks()
+{
+    insideJob = true;
+    for (;;)
+    {
+        size_t begin = m_next.fetch_add(m_grain);
+        if (begin >= m_count)
+            break;
+        (*m_job)(begin, std::min(begin + m_grain, m_count));
+    }
+    insideJob = false;
+}
+
+void WorkerPool::WorkerLoop()
+{
+    uint64_t seen = 0;
+    for (;;)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_wake.wait(lock, [&]
+                    { return m_quit || m_generation != seen; });
+        if (m_quit)
+            return;
+        seen = m_generation;
+        lock.unlock();
+
+        RunChunks();
+
+        lock.lock();
+        if (--m_active == 0)
+            m_done.notify_all();
+    }
+}
+
+void WorkerPool::ParallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)> &func)
+{
+    if (count == 0)
+        return;
+    grain = std::max<size_t>(grain, 1);
+    if (m_threads.empty() || count <= grain || insideJob)
+    {
+        for (size_t begin = 0; begin < count; begin += grain)
+            func(begin, std::min(begin + grain, count));
+        return;
+    }
+
+    std::lock_guard<std::mutex> submit(m_submitMutex);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_job = &func;
+        m_count = count;
+        m_grain = grain;
+        m_next = 0;
+        m_active = m_threads.size();
+        ++m_generation;
+    }
+    m_wake.notify_all();
+
+    RunChunks();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [&]
+                { return m_active == 0; });
+    m_job = nullptr;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Persistent worker threads shared by all CPU-side frame work (culling, pose evaluation, baking...).
+class WorkerPool
+{
+private:
+    std::vector<std::thread> m_threads;
+    std::mutex m_mutex;
+    std::mutex m_submitMutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+    const std::function<void(size_t, size_t)> *m_job = nullptr;
+    size_t m_count = 0;
+    size_t m_grain = 1;
+    std::atomic<size_t> m_next{0};
+    size_t m_active = 0;
+    uint64_t m_generation = 0;
+    bool m_quit = false;
+
+    void WorkerLoop();
+    void RunChunks();
+
+public:
+    // threadCount == 0 uses one worker per hardware thread besides the caller
+    explicit WorkerPool(unsigned threadCount = 0);
+    ~WorkerPool();
+    static WorkerPool &Instance();
+
+    // number of threads that execute a ParallelFor, including the calling thread
+    unsigned GetThreadCount() const
+    {
+        return static_cast<unsigned>(m_threads.size()) + 1;
+    }
+    // calls func(begin, end) over [0, count) in chunks of at most grain items and blocks until all are done;
+    // nested calls from inside a job run inline on the calling worker
+    void ParallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)> &func);
+};
+
+inline void ParallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)> &func)
+{
+    WorkerPool::Instance().ParallelFor(count, grain, func);
+}
@@ -0,0 +1,10 @@
+#include "pass_inputs.h"
+
+bool PassInputs::Update()
+{
+    bool changed = !m_valid || m_current != m_previous;
+    m_previous.swap(m_current);
+    m_current.clear();
+    m_valid = true;
+    return changed;
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+// Signature of everything a group of passes reads from outside the GPU (matrices, transforms, settings), gathered
+// anew every frame. Update compares it with the signature of the previous frame, so passes whose inputs did not
+// change can keep their results instead of re-rendering them. Values are compared bit for bit.
+class PassInputs
+{
+private:
+    std::vector<unsigned char> m_current;
+    std::vector<unsigned char> m_previous;
+    bool m_valid = false;
+
+public:
+    template <typename T>
+    PassInputs &Add(const T &value)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "inputs are compared as raw bytes");
+        size_t offset = m_current.size();
+        m_current.resize(offset + sizeof(T));
+        std::memcpy(m_current.data() + offset, &value, sizeof(T));
+        return *this;
+    }
+    // returns true when the inputs added since the last call differ from the ones before, or were invalidated
+    bool Update();
+    // the next Update reports a change whatever the inputs, e.g. when the results were lost
+    void Invalidate()
+    {
+        m_valid = false;
+    }
+};
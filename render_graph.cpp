@@ -0,0 +1,334 @@
+#include "render_graph.h"
+#include "gl_ext.h"
+#include <algorithm>
+
+RenderPass &RenderPass::Read(RenderResource resource)
+{
+    m_reads.push_back(resource);
+    return *this;
+}
+
+RenderPass &RenderPass::Write(RenderResource resource)
+{
+    m_writes.push_back(resource);
+    return *this;
+}
+
+RenderPass &RenderPass::WriteAttachment(RenderResource resource, GLenum attachment, LoadOp load)
+{
+    m_attachments.push_back({resource, attachment, load});
+    return *this;
+}
+
+RenderPass &RenderPass::WriteBackbuffer(GLsizei width, GLsizei height, LoadOp load)
+{
+    m_backbuffer = true;
+    m_backbufferLoad = load;
+    m_backbufferWidth = width;
+    m_backbufferHeight = height;
+    return *this;
+}
+
+RenderGraph::~RenderGraph()
+{
+    for (auto &framebuffer : m_framebuffers)
+        glDeleteFramebuffers(1, &framebuffer.second.fbo);
+}
+
+RenderResource RenderGraph::Create(const std::string &name, const TextureDesc &desc)
+{
+    m_resources.push_back({name, desc, 0, false, -1, -1});
+    return {(int)m_resources.size() - 1};
+}
+
+RenderResource RenderGraph::Import(const std::string &name, GLuint texture, const TextureDesc &desc)
+{
+    m_resources.push_back({name, desc, texture, true, -1, -1});
+    return {(int)m_resources.size() - 1};
+}
+
+RenderPass &RenderGraph::AddPass(const std::string &name, std::function<void()> execute)
+{
+    m_passes.emplace_back(new RenderPass());
+    m_passes.back()->m_name = name;
+    m_passes.back()->m_execute = std::move(execute);
+    return *m_passes.back();
+}
+
+GLuint RenderGraph::GetTexture(RenderResource resource) const
+{
+    return resource.IsValid() ? m_resources[resource.index].texture : 0;
+}
+
+std::vector<int> RenderGraph::SortPasses() const
+{
+    size_t passCount = m_passes.size();
+    std::vector<std::vector<int>> writers(m_resources.size());
+    std::vector<std::vector<int>> readers(m_resources.size());
+    for (size_t p = 0; p < passCount; ++p)
+    {
+        const RenderPass &pass = *m_passes[p];
+        auto addWriter = [&](RenderResource resource)
+        {
+            std::vector<int> &list = writers[resource.index];
+            if (list.empty() || list.back() != (int)p)
+                list.push_back((int)p);
+        };
+        for (const auto &write : pass.m_writes)
+            addWriter(write);
+        for (const auto &attachment : pass.m_attachments)
+            addWriter(attachment.resource);
+        for (const auto &read : pass.m_reads)
+            readers[read.index].push_back((int)p);
+    }
+
+    // writers of a resource keep their declaration order, readers see the result of the last one
+    std::vector<std::vector<int>> predecessors(passCount);
+    for (size_t r = 0; r < m_resources.size(); ++r)
+    {
+        const std::vector<int> &list = writers[r];
+        for (size_t i = 1; i < list.size(); ++i)
+            predecessors[list[i]].push_back(list[i - 1]);
+        for (int reader : readers[r])
+        {
+            if (!list.empty() && std::find(list.begin(), list.end(), reader) == list.end())
+                predecessors[reader].push_back(list.back());
+        }
+    }
+
+    // passes that reach the backbuffer or an imported texture, and everything they depend on
+    std::vector<bool> needed(passCount, false);
+    std::vector<int> stack;
+    for (size_t p = 0; p < passCount; ++p)
+    {
+        const RenderPass &pass = *m_passes[p];
+        bool root = pass.m_backbuffer;
+        for (const auto &write : pass.m_writes)
+            root = root || m_resources[write.index].imported;
+        for (const auto &attachment : pass.m_attachments)
+            root = root || m_resources[attachment.resource.index].imported;
+        if (root)
+        {
+            needed[p] = true;
+            stack.push_back((int)p);
+        }
+    }
+    while (!stack.empty())
+    {
+        int p = stack.back();
+        stack.pop_back();
+        for (int predecessor : predecessors[p])
+        {
+            if (!needed[predecessor])
+            {
+                needed[predecessor] = true;
+                stack.push_back(predecessor);
+            }
+        }
+    }
+
+    // topological order, ties broken by declaration order
+    std::vector<int> order;
+    std::vector<bool> done(passCount, false);
+    for (size_t emitted = 0; emitted < passCount;)
+    {
+        size_t next = passCount;
+        for (size_t p = 0; p < passCount && next == passCount; ++p)
+        {
+            if (done[p])
+                continue;
+            bool ready = true;
+            for (int predecessor : predecessors[p])
+                ready = ready && done[predecessor];
+            if (ready)
+                next = p;
+        }
+        if (next == passCount)
+        {
+            std::cout << "Render graph has a cycle, remaining passes are skipped" << std::endl;
+            break;
+        }
+        done[next] = true;
+        ++emitted;
+        if (needed[next])
+            order.push_back((int)next);
+    }
+    return order;
+}
+
+void RenderGraph::BindAttachments(const RenderPass &pass, int position)
+{
+    if (pass.m_attachments.empty())
+    {
+        if (!pass.m_backbuffer)
+            return;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glViewport(0, 0, pass.m_backbufferWidth, pass.m_backbufferHeight);
+        if (pass.m_backbufferLoad == LoadOp::Clear)
+        {
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+        }
+        else if (pass.m_backbufferLoad == LoadOp::DontCare && GetGLCapabilities().invalidateSubdata)
+        {
+            const GLenum buffers[] = {GL_COLOR, GL_DEPTH, GL_STENCIL};
+            glInvalidateFramebufferExt(GL_FRAMEBUFFER, 3, buffers);
+        }
+        return;
+    }
+
+    Framebuffer &framebuffer = m_framebuffers[pass.m_name];
+    if (framebuffer.fbo == 0)
+        glGenFramebuffers(1, &framebuffer.fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer.fbo);
+
+    // textures are reattached every frame: a pool texture deleted while attached here may hand its name
+    // to a new texture, so an unchanged name does not mean an unchanged attachment
+    std::vector<GLenum> attachments;
+    std::vector<GLuint> textures;
+    std::vector<GLenum> drawBuffers;
+    for (const auto &write : pass.m_attachments)
+    {
+        GLuint texture = m_resources[write.resource.index].texture;
+        glFramebufferTexture2D(GL_FRAMEBUFFER, write.attachment, GL_TEXTURE_2D, texture, 0);
+        attachments.push_back(write.attachment);
+        textures.push_back(texture);
+        if (write.attachment >= GL_COLOR_ATTACHMENT0 && write.attachment <= GL_COLOR_ATTACHMENT15)
+            drawBuffers.push_back(write.attachment);
+    }
+    for (GLenum previous : framebuffer.attachments)
+    {
+        if (std::find(attachments.begin(), attachments.end(), previous) == attachments.end())
+            glFramebufferTexture2D(GL_FRAMEBUFFER, previous, GL_TEXTURE_2D, 0, 0);
+    }
+    if (drawBuffers.empty())
+    {
+        // depth-only: without a color buffer to read either, a strict 3.3 core context reports it incomplete
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+    }
+    else
+        glDrawBuffers((GLsizei)drawBuffers.size(), drawBuffers.data());
+    if ((attachments != framebuffer.attachments || textures != framebuffer.textures) && glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cout << "Framebuffer of pass " << pass.m_name << " not complete!" << std::endl;
+    }
+    framebuffer.attachments = attachments;
+    framebuffer.textures = textures;
+
+    const TextureDesc &size = m_resources[pass.m_attachments[0].resource.index].desc;
+    glViewport(0, 0, size.width, size.height);
+
+    // a transient has no contents before its first use, so loading it is as good as discarding
+    std::vector<GLenum> discarded;
+    const GLfloat zero[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    for (const auto &write : pass.m_attachments)
+    {
+        const Resource &resource = m_resources[write.resource.index];
+        LoadOp load = write.load;
+        if (load == LoadOp::Load && !resource.imported && resource.firstUse == position)
+            load = LoadOp::DontCare;
+        if (load == LoadOp::Clear)
+        {
+            if (write.attachment == GL_DEPTH_ATTACHMENT)
+            {
+                GLfloat far = 1.0f;
+                glClearBufferfv(GL_DEPTH, 0, &far);
+            }
+            else if (write.attachment == GL_DEPTH_STENCIL_ATTACHMENT)
+            {
+                glClearBufferfi(GL_DEPTH_STENCIL, 0, 1.0f, 0);
+            }
+            else
+            {
+                GLint drawBuffer = (GLint)(std::find(drawBuffers.begin(), drawBuffers.end(), write.attachment) - drawBuffers.begin());
+                glClearBufferfv(GL_COLOR, drawBuffer, zero);
+            }
+        }
+        else if (load == LoadOp::DontCare)
+        {
+            discarded.push_back(write.attachment);
+        }
+    }
+    if (!discarded.empty() && GetGLCapabilities().invalidateSubdata)
+        glInvalidateFramebufferExt(GL_FRAMEBUFFER, (GLsizei)discarded.size(), discarded.data());
+}
+
+void RenderGraph::Execute()
+{
+    std::vector<int> order = SortPasses();
+
+    // lifetimes in execution order; resources of culled passes are never allocated
+    for (int position = 0; position < (int)order.size(); ++position)
+    {
+        const RenderPass &pass = *m_passes[order[position]];
+        auto use = [&](RenderResource resource)
+        {
+            Resource &r = m_resources[resource.index];
+            if (r.firstUse < 0)
+                r.firstUse = position;
+            r.lastUse = position;
+        };
+        for (const auto &read : pass.m_reads)
+            use(read);
+        for (const auto &write : pass.m_writes)
+            use(write);
+        for (const auto &attachment : pass.m_attachments)
+            use(attachment.resource);
+    }
+
+    m_executedPasses.clear();
+    for (int position = 0; position < (int)order.size(); ++position)
+    {
+        RenderPass &pass = *m_passes[order[position]];
+        for (auto &resource : m_resources)
+        {
+            if (!resource.imported && resource.firstUse == position)
+                resource.texture = m_pool.Acquire(resource.desc);
+        }
+
+        // the timers do not nest, so passes must not run GL_TIME_ELAPSED queries of their own
+        GpuTimer &timer = GetPassTimer(pass.m_name);
+        timer.Begin();
+        BindAttachments(pass, position);
+        pass.m_execute();
+        timer.End();
+        m_executedPasses.push_back(pass.m_name);
+
+        // dead transients go back to the pool, where later transients of the same format pick them up
+        for (auto &resource : m_resources)
+        {
+            if (resource.imported || resource.lastUse != position)
+                continue;
+            if (GetGLCapabilities().invalidateSubdata)
+                glInvalidateTexImageExt(resource.texture, 0);
+            m_pool.Release(resource.texture);
+            resource.texture = 0;
+        }
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    for (auto &timer : m_passTimers)
+        timer.second->Update();
+
+    m_passes.clear();
+    m_resources.clear();
+}
+
+GpuTimer &RenderGraph::GetPassTimer(const std::string &name)
+{
+    std::unique_ptr<GpuTimer> &timer = m_passTimers[name];
+    if (!timer)
+        timer.reset(new GpuTimer());
+    return *timer;
+}
+
+double RenderGraph::GetFrameMilliseconds() const
+{
+    double milliseconds = 0.0;
+    for (const std::string &name : m_executedPasses)
+    {
+        auto timer = m_passTimers.find(name);
+        if (timer != m_passTimers.end())
+            milliseconds += timer->second->GetMilliseconds();
+    }
+    return milliseconds;
+}
@@ -0,0 +1,123 @@
+#pragma once
+#include "render_target.h"
+#include "gpu_timer.h"
+#include <functional>
+
+// What a pass needs from an attachment's previous contents when it starts writing it.
+enum class LoadOp
+{
+    // keep what earlier passes wrote
+    Load,
+    // clear to zero color / far depth
+    Clear,
+    // the pass overwrites every texel it cares about, previous contents are discarded
+    DontCare
+};
+
+// Index of a texture in the graph of the current frame.
+struct RenderResource
+{
+    int index = -1;
+    bool IsValid() const
+    {
+        return index >= 0;
+    }
+};
+
+class RenderGraph;
+
+// A pass with its declared reads and writes. The graph binds the framebuffer made of the pass's attachments
+// (or the default framebuffer) and sets the viewport before calling execute.
+class RenderPass
+{
+private:
+    friend class RenderGraph;
+    struct AttachmentWrite
+    {
+        RenderResource resource;
+        GLenum attachment;
+        LoadOp load;
+    };
+    std::string m_name;
+    std::function<void()> m_execute;
+    std::vector<RenderResource> m_reads;
+    std::vector<RenderResource> m_writes;
+    std::vector<AttachmentWrite> m_attachments;
+    bool m_backbuffer = false;
+    LoadOp m_backbufferLoad = LoadOp::Clear;
+    GLsizei m_backbufferWidth = 0;
+    GLsizei m_backbufferHeight = 0;
+
+public:
+    // sampled by the pass
+    RenderPass &Read(RenderResource resource);
+    // written without being attached, e.g. as an image by a compute shader
+    RenderPass &Write(RenderResource resource);
+    // rendered to; LoadOp::Load also makes the pass depend on the previous writers
+    RenderPass &WriteAttachment(RenderResource resource, GLenum attachment, LoadOp load);
+    // renders to the default framebuffer, which keeps the pass alive
+    RenderPass &WriteBackbuffer(GLsizei width, GLsizei height, LoadOp load);
+};
+
+// Per-frame graph of passes. Passes are declared in any order together with the textures they read and write;
+// Execute orders them so that every resource is read in the state left by its last writer, drops passes that
+// contribute neither to the backbuffer nor to an imported texture, and allocates the transient textures from
+// the pool only for the span of passes that use them. A transient is handed back to the pool right after its
+// last use, so a later transient of the same format and size reuses the same texture within the frame.
+class RenderGraph
+{
+private:
+    struct Resource
+    {
+        std::string name;
+        TextureDesc desc;
+        GLuint texture;
+        bool imported;
+        // position of the first and last pass using it in the execution order
+        int firstUse;
+        int lastUse;
+    };
+    struct Framebuffer
+    {
+        GLuint fbo = 0;
+        std::vector<GLenum> attachments;
+        std::vector<GLuint> textures;
+    };
+    RenderTargetPool &m_pool;
+    std::vector<Resource> m_resources;
+    std::vector<std::unique_ptr<RenderPass>> m_passes;
+    // one framebuffer per pass name, reattached every frame
+    std::map<std::string, Framebuffer> m_framebuffers;
+    std::vector<std::string> m_executedPasses;
+    // GPU time of every pass, clears and discards included, by pass name
+    std::map<std::string, std::unique_ptr<GpuTimer>> m_passTimers;
+
+    std::vector<int> SortPasses() const;
+    // binds the pass's framebuffer, then clears or discards the attachments it starts writing
+    void BindAttachments(const RenderPass &pass, int position);
+
+public:
+    explicit RenderGraph(RenderTargetPool &pool) : m_pool(pool) {}
+    RenderGraph(const RenderGraph &) = delete;
+    RenderGraph &operator=(const RenderGraph &) = delete;
+    ~RenderGraph();
+
+    // transient texture, only alive while the graph executes
+    RenderResource Create(const std::string &name, const TextureDesc &desc);
+    // texture owned outside the graph, e.g. history kept across frames; writing it keeps the writer alive
+    RenderResource Import(const std::string &name, GLuint texture, const TextureDesc &desc);
+    RenderPass &AddPass(const std::string &name, std::function<void()> execute);
+    // texture of a resource, valid inside the execute callbacks of the passes using it
+    GLuint GetTexture(RenderResource resource) const;
+    // runs the passes and resets the graph for the next frame
+    void Execute();
+    // names of the passes run by the last Execute, in execution order
+    const std::vector<std::string> &GetExecutedPasses() const
+    {
+        return m_executedPasses;
+    }
+    // timer of the passes with this name, created on first use; its results arrive a few frames late
+    GpuTimer &GetPassTimer(const std::string &name);
+    // sum of the latest results of the passes run by the last Execute, the GPU time of a frame made of them
+    double GetFrameMilliseconds() const;
+};
@@ -0,0 +1,239 @@
+#include "render_target.h"
+#include <algorithm>
+
+static void GetPixelTransfer(GLenum internalFormat, GLenum &format, GLenum &type)
+{
+    switch (internalFormat)
+    {
+    case GL_R8:
+        format = GL_RED;
+        type = GL_UNSIGNED_BYTE;
+        break;
+    case GL_R16F:
+    case GL_R32F:
+        format = GL_RED;
+        type = GL_FLOAT;
+        break;
+    case GL_RG8:
+        format = GL_RG;
+        type = GL_UNSIGNED_BYTE;
+        break;
+    case GL_RG16:
+        format = GL_RG;
+        type = GL_UNSIGNED_SHORT;
+        break;
+    case GL_RG16F:
+    case GL_RG32F:
+        format = GL_RG;
+        type = GL_FLOAT;
+        break;
+    case GL_RG16I:
+        format = GL_RG_INTEGER;
+        type = GL_SHORT;
+        break;
+    case GL_RGB16F:
+        format = GL_RGB;
+        type = GL_FLOAT;
+        break;
+    case GL_RGBA16F:
+    case GL_RGBA32F:
+        format = GL_RGBA;
+        type = GL_FLOAT;
+        break;
+    case GL_DEPTH_COMPONENT24:
+    case GL_DEPTH_COMPONENT32F:
+        format = GL_DEPTH_COMPONENT;
+        type = GL_FLOAT;
+        break;
+    case GL_DEPTH24_STENCIL8:
+        format = GL_DEPTH_STENCIL;
+        type = GL_UNSIGNED_INT_24_8;
+        break;
+    default:
+        format = GL_RGBA;
+        type = GL_UNSIGNED_BYTE;
+        break;
+    }
+}
+
+GLsizeiptr GetTexelSize(GLenum internalFormat)
+{
+    switch (internalFormat)
+    {
+    case GL_R8:
+        return 1;
+    case GL_R16F:
+    case GL_RG8:
+        return 2;
+    case GL_RGB16F:
+        return 6;
+    case GL_RGBA16F:
+    case GL_RG32F:
+        return 8;
+    case GL_RGBA32F:
+        return 16;
+    default:
+        return 4;
+    }
+}
+
+RenderTargetPool::~RenderTargetPool()
+{
+    for (auto &entry : m_entries)
+        glDeleteTextures(1, &entry.texture);
+}
+
+GLuint RenderTargetPool::Acquire(const TextureDesc &desc)
+{
+    for (auto &entry : m_entries)
+    {
+        if (!entry.inUse && entry.desc == desc)
+        {
+            entry.inUse = true;
+            entry.lastUsedFrame = m_frame;
+            return entry.texture;
+        }
+    }
+
+    GLenum format, type;
+    GetPixelTransfer(desc.internalFormat, format, type);
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, desc.internalFormat, desc.width, desc.height, 0, format, type, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, desc.filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, desc.filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    m_entries.push_back({texture, desc, true, m_frame});
+    return texture;
+}
+
+void RenderTargetPool::Release(GLuint texture)
+{
+    for (auto &entry : m_entries)
+    {
+        if (entry.texture == texture)
+        {
+            entry.inUse = false;
+            entry.lastUsedFrame = m_frame;
+            return;
+        }
+    }
+}
+
+void RenderTargetPool::EndFrame()
+{
+    ++m_frame;
+    auto evict = [&](size_t i)
+    {
+        glDeleteTextures(1, &m_entries[i].texture);
+        m_entries.erase(m_entries.begin() + i);
+    };
+    for (size_t i = m_entries.size(); i-- > 0;)
+    {
+        if (!m_entries[i].inUse && m_frame - m_entries[i].lastUsedFrame > m_maxIdleFrames)
+            evict(i);
+    }
+
+    for (;;)
+    {
+        GLsizeiptr idleBytes = 0;
+        size_t oldest = m_entries.size();
+        for (size_t i = 0; i < m_entries.size(); ++i)
+        {
+            const Entry &entry = m_entries[i];
+            if (entry.inUse)
+                continue;
+            idleBytes += entry.desc.width * entry.desc.height * GetTexelSize(entry.desc.internalFormat);
+            if (oldest == m_entries.size() || entry.lastUsedFrame < m_entries[oldest].lastUsedFrame)
+                oldest = i;
+        }
+        if (idleBytes <= m_idleBudget || oldest == m_entries.size())
+            break;
+        evict(oldest);
+    }
+}
+
+GLsizeiptr RenderTargetPool::GetAllocatedBytes() const
+{
+    GLsizeiptr bytes = 0;
+    for (const auto &entry : m_entries)
+        bytes += entry.desc.width * entry.desc.height * GetTexelSize(entry.desc.internalFormat);
+    return bytes;
+}
+
+void RenderTarget::AddAttachment(GLenum attachment, GLenum internalFormat, GLenum filter)
+{
+    m_attachments.push_back({attachment, internalFormat, filter, 0});
+}
+
+bool RenderTarget::Resize(RenderTargetPool &pool, GLsizei width, GLsizei height)
+{
+    if (width == m_width && height == m_height && m_fbo != 0)
+        return false;
+    if (m_fbo == 0)
+        glGenFramebuffers(1, &m_fbo);
+    m_width = width;
+    m_height = height;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+    std::vector<GLenum> drawBuffers;
+    for (auto &attachment : m_attachments)
+    {
+        if (attachment.texture != 0)
+            pool.Release(attachment.texture);
+        attachment.texture = pool.Acquire({width, height, attachment.internalFormat, attachment.filter});
+        glFramebufferTexture2D(GL_FRAMEBUFFER, attachment.attachment, GL_TEXTURE_2D, attachment.texture, 0);
+        if (attachment.attachment >= GL_COLOR_ATTACHMENT0 && attachment.attachment <= GL_COLOR_ATTACHMENT15)
+            drawBuffers.push_back(attachment.attachment);
+    }
+    // - Tell OpenGL which color attachments we'll use (of this framebuffer) for rendering
+    if (drawBuffers.empty())
+    {
+        // depth-only: without a color buffer to read either, a strict 3.3 core context reports it incomplete
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+    }
+    else
+        glDrawBuffers((GLsizei)drawBuffers.size(), drawBuffers.data());
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cout << "Framebuffer not complete!" << std::endl;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    return true;
+}
+
+void RenderTarget::Release(RenderTargetPool &pool)
+{
+    for (auto &attachment : m_attachments)
+    {
+        if (attachment.texture != 0)
+            pool.Release(attachment.texture);
+        attachment.texture = 0;
+    }
+    m_width = m_height = 0;
+}
+
+GLuint RenderTarget::GetTexture(GLenum attachment) const
+{
+    for (const auto &a : m_attachments)
+    {
+        if (a.attachment == attachment)
+            return a.texture;
+    }
+    return 0;
+}
+
+void RenderTarget::Bind() const
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+    glViewport(0, 0, m_width, m_height);
+}
+
+RenderTarget::~RenderTarget()
+{
+    if (m_fbo != 0)
+        glDeleteFramebuffers(1, &m_fbo);
+}
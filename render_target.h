@@ -0,0 +1,88 @@
+#pragma once
+#include "utils.h"
+#include <cstdint>
+
+struct TextureDesc
+{
+    GLsizei width = 0;
+    GLsizei height = 0;
+    GLenum internalFormat = GL_RGBA8;
+    GLenum filter = GL_NEAREST;
+
+    bool operator==(const TextureDesc &other) const
+    {
+        return width == other.width && height == other.height && internalFormat == other.internalFormat && filter == other.filter;
+    }
+};
+
+// Bytes per texel of the internal formats used for render targets.
+GLsizeiptr GetTexelSize(GLenum internalFormat);
+
+// Render target textures pooled by format and size. Released textures stay alive for a while so that
+// shrink/grow cycles (window resizes, render scale changes) reuse them instead of reallocating.
+class RenderTargetPool
+{
+private:
+    struct Entry
+    {
+        GLuint texture;
+        TextureDesc desc;
+        bool inUse;
+        uint64_t lastUsedFrame;
+    };
+    std::vector<Entry> m_entries;
+    uint64_t m_frame = 0;
+    uint64_t m_maxIdleFrames;
+    GLsizeiptr m_idleBudget;
+
+public:
+    RenderTargetPool(uint64_t maxIdleFrames = 240, GLsizeiptr idleBudget = 256ll << 20)
+        : m_maxIdleFrames(maxIdleFrames), m_idleBudget(idleBudget) {}
+    ~RenderTargetPool();
+
+    GLuint Acquire(const TextureDesc &desc);
+    void Release(GLuint texture);
+    // frees textures that stayed idle too long, then the least recently used ones above the idle budget
+    void EndFrame();
+    GLsizeiptr GetAllocatedBytes() const;
+};
+
+// A framebuffer whose attachments are pool textures that are reallocated when the target is resized.
+class RenderTarget
+{
+private:
+    struct Attachment
+    {
+        GLenum attachment;
+        GLenum internalFormat;
+        GLenum filter;
+        GLuint texture;
+    };
+    GLuint m_fbo = 0;
+    std::vector<Attachment> m_attachments;
+    GLsizei m_width = 0;
+    GLsizei m_height = 0;
+
+public:
+    // attachments must be declared before the first Resize
+    void AddAttachment(GLenum attachment, GLenum internalFormat, GLenum filter = GL_NEAREST);
+    // returns false when the size did not change and nothing was reallocated
+    bool Resize(RenderTargetPool &pool, GLsizei width, GLsizei height);
+    void Release(RenderTargetPool &pool);
+    GLuint GetTexture(GLenum attachment) const;
+    GLuint GetFramebuffer() const
+    {
+        return m_fbo;
+    }
+    GLsizei GetWidth() const
+    {
+        return m_width;
+    }
+    GLsizei GetHeight() const
+    {
+        return m_height;
+    }
+    // binds the framebuffer and sets the viewport to cover it
+    void Bind() const;
+    ~RenderTarget();
+};
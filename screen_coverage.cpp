@@ -0,0 +1,92 @@
+#include "screen_coverage.h"
+#include <algorithm>
+#include <cmath>
+
+bool ProjectSphereAxis(float center, float depth, float radius, float projectionScale, float &uvMin, float &uvMax)
+{
+    uvMin = 0.0f;
+    uvMax = 1.0f;
+    float denominator = depth * depth - radius * radius;
+    if (depth <= radius || denominator <= 0.0f)
+        return true;
+    float root = std::sqrt(center * center + denominator);
+    float slopeMin = (center * depth - radius * root) / denominator;
+    float slopeMax = (center * depth + radius * root) / denominator;
+    uvMin = slopeMin * projectionScale * 0.5f + 0.5f;
+    uvMax = slopeMax * projectionScale * 0.5f + 0.5f;
+    return uvMax >= 0.0f && uvMin <= 1.0f;
+}
+
+bool ProjectSphere(const glm::vec3 &center, float radius, const glm::mat4 &view, const glm::mat4 &projection,
+                   GLsizei width, GLsizei height, ScreenRect &rect, float *projectedHeight)
+{
+    glm::vec4 viewCenter = view * glm::vec4(center, 1.0f);
+    float depth = -viewCenter.z;
+    if (depth + radius <= 0.0f)
+        return false;
+    float minX, maxX, minY, maxY;
+    if (!ProjectSphereAxis(viewCenter.x, depth, radius, projection[0][0], minX, maxX) ||
+        !ProjectSphereAxis(viewCenter.y, depth, radius, projection[1][1], minY, maxY))
+        return false;
+    if (projectedHeight)
+        *projectedHeight = (maxY - minY) * height;
+    GLint x0 = std::max(0, (GLint)std::floor(minX * width));
+    GLint y0 = std::max(0, (GLint)std::floor(minY * height));
+    GLint x1 = std::min((GLint)width, (GLint)std::ceil(maxX * width));
+    GLint y1 = std::min((GLint)height, (GLint)std::ceil(maxY * height));
+    if (x1 <= x0 || y1 <= y0)
+        return false;
+    rect = {x0, y0, x1 - x0, y1 - y0};
+    return true;
+}
+
+std::vector<ScreenRect> ClassifyTiles(const std::vector<ScreenRect> &rects, GLsizei width, GLsizei height, int tileSize)
+{
+    int tilesX = (width + tileSize - 1) / tileSize;
+    int tilesY = (height + tileSize - 1) / tileSize;
+    std::vector<unsigned char> covered(tilesX * tilesY, 0);
+    for (const ScreenRect &rect : rects)
+    {
+        int tx1 = std::min(tilesX - 1, (int)(rect.x + rect.width - 1) / tileSize);
+        int ty1 = std::min(tilesY - 1, (int)(rect.y + rect.height - 1) / tileSize);
+        for (int ty = rect.y / tileSize; ty <= ty1; ++ty)
+            std::fill(covered.begin() + ty * tilesX + rect.x / tileSize, covered.begin() + ty * tilesX + tx1 + 1, 1);
+    }
+
+    // rectangles whose run the previous row ended with; an identical run in the next row extends them
+    std::vector<ScreenRect> result;
+    std::vector<size_t> open;
+    for (int ty = 0; ty < tilesY; ++ty)
+    {
+        std::vector<size_t> stillOpen;
+        for (int tx = 0; tx < tilesX;)
+        {
+            if (!covered[ty * tilesX + tx])
+            {
+                ++tx;
+                continue;
+            }
+            int begin = tx;
+            while (tx < tilesX && covered[ty * tilesX + tx])
+                ++tx;
+            GLint x = begin * tileSize;
+            GLsizei runWidth = std::min((GLint)width, tx * tileSize) - x;
+            GLint y = ty * tileSize;
+            GLsizei rowHeight = std::min((GLint)height, y + tileSize) - y;
+            auto same = std::find_if(open.begin(), open.end(), [&](size_t r)
+                                     { return result[r].x == x && result[r].width == runWidth; });
+            if (same != open.end())
+            {
+                result[*same].height += rowHeight;
+                stillOpen.push_back(*same);
+            }
+            else
+            {
+                result.push_back({x, y, runWidth, rowHeight});
+                stillOpen.push_back(result.size() - 1);
+            }
+        }
+        open.swap(stillOpen);
+    }
+    return result;
+}
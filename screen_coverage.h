@@ -0,0 +1,27 @@
+#pragma once
+#include "utils.h"
+
+// Pixel rectangle [x, x + width) x [y, y + height), origin at the bottom left like glScissor.
+struct ScreenRect
+{
+    GLint x = 0;
+    GLint y = 0;
+    GLsizei width = 0;
+    GLsizei height = 0;
+};
+
+// Screen-space extent along one axis of a view-space sphere (center along the axis, depth along the view
+// direction), from the two planes through the eye tangent to it. projectionScale is projection[0][0] or [1][1].
+// Returns false when the sphere misses [0, 1]; uvMin / uvMax cover the whole axis when the eye is inside it.
+bool ProjectSphereAxis(float center, float depth, float radius, float projectionScale, float &uvMin, float &uvMax);
+
+// Conservative pixel bounds of a world-space sphere; false when it is off screen or behind the camera. rect is
+// clipped to the viewport; projectedHeight, when given, receives the unclipped height in pixels (the whole viewport
+// height when the eye is inside the sphere).
+bool ProjectSphere(const glm::vec3 &center, float radius, const glm::mat4 &view, const glm::mat4 &projection,
+                   GLsizei width, GLsizei height, ScreenRect &rect, float *projectedHeight = nullptr);
+
+// Covered tiles of the screen: rectangles are rasterized into a grid of tileSize pixel tiles and the covered tiles
+// are returned as few rectangles (runs along rows, merged with identical runs of the rows above). Overlapping
+// objects are covered once, and the count stays small however many objects there are.
+std::vector<ScreenRect> ClassifyTiles(const std::vector<ScreenRect> &rects, GLsizei width, GLsizei height, int tileSize = 32);
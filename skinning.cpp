@@ -0,0 +1,144 @@
+#include "skinning.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+static void SampleTrack(const JointTrack &track, float time, glm::vec3 &translation, glm::quat &rotation)
+{
+    if (track.times.empty())
+        return;
+    size_t next = std::upper_bound(track.times.begin(), track.times.end(), time) - track.times.begin();
+    size_t prev = next == 0 ? 0 : next - 1;
+    next = std::min(next, track.times.size() - 1);
+    float span = track.times[next] - track.times[prev];
+    float f = span > 0.0f ? (time - track.times[prev]) / span : 0.0f;
+    if (!track.translations.empty())
+        translation = glm::mix(track.translations[prev], track.translations[next], f);
+    if (!track.rotations.empty())
+        rotation = glm::normalize(glm::slerp(track.rotations[prev], track.rotations[next], f));
+}
+
+void EvaluatePoses(std::vector<SkinnedInstance> &instances, float deltaTime)
+{
+    ParallelFor(instances.size(), 1, [&](size_t begin, size_t end)
+                {
+        std::vector<glm::mat4> globals;
+        for (size_t i = begin; i < end; ++i)
+        {
+            SkinnedInstance &instance = instances[i];
+            const std::vector<Joint> &joints = instance.skeleton->joints;
+            const AnimationClip *clip = instance.clip;
+            if (clip && clip->duration > 0.0f)
+                instance.time = std::fmod(instance.time + deltaTime, clip->duration);
+
+            globals.resize(joints.size());
+            instance.skinMatrices.resize(joints.size());
+            for (size_t j = 0; j < joints.size(); ++j)
+            {
+                const Joint &joint = joints[j];
+                glm::vec3 translation = joint.translation;
+                glm::quat rotation = joint.rotation;
+                if (clip && j < clip->tracks.size())
+                    SampleTrack(clip->tracks[j], instance.time, translation, rotation);
+                glm::mat4 local = glm::translate(glm::mat4(1.0f), translation) * glm::mat4_cast(rotation);
+                globals[j] = joint.parent < 0 ? local : globals[joint.parent] * local;
+                instance.skinMatrices[j] = globals[j] * joint.inverseBind;
+            }
+        } });
+}
+
+void BonePalette::Upload(const std::vector<SkinnedInstance> &instances)
+{
+    GLint alignment = 256;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    GLsizeiptr paletteSize = MAX_BONES * sizeof(glm::mat4);
+    m_stride = (paletteSize + alignment - 1) / alignment * alignment;
+    GLsizeiptr size = m_stride * std::max<GLsizeiptr>(instances.size(), 1);
+
+    m_staging.resize(size);
+    for (size_t i = 0; i < instances.size(); ++i)
+    {
+        size_t count = std::min<size_t>(instances[i].skinMatrices.size(), MAX_BONES);
+        if (count > 0)
+            std::memcpy(&m_staging[i * m_stride], instances[i].skinMatrices.data(), count * sizeof(glm::mat4));
+    }
+
+    if (m_ubo == 0)
+        glGenBuffers(1, &m_ubo);
+    glBindBuffer(GL_UNIFORM_BUFFER, m_ubo);
+    // orphan the previous frame's storage instead of waiting for the GPU to finish reading it
+    m_capacity = std::max(m_capacity, size);
+    glBufferData(GL_UNIFORM_BUFFER, m_capacity, NULL, GL_DYNAMIC_DRAW);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, size, m_staging.data());
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void BonePalette::Bind(size_t instance) const
+{
+    glBindBufferRange(GL_UNIFORM_BUFFER, BONE_PALETTE_BINDING, m_ubo, instance * m_stride, MAX_BONES * sizeof(glm::mat4));
+}
+
+BonePalette::~BonePalette()
+{
+    if (m_ubo != 0)
+        glDeleteBuffers(1, &m_ubo);
+}
+
+const SwayingSphere &GetSwayingSphere()
+{
+    static SwayingSphere creature;
+    if (creature.mesh.indexCount == 0)
+    {
+        // joints at y = -1, 0, 1 in the bind pose
+        const float jointHeights[3] = {-1.0f, 0.0f, 1.0f};
+        for (int j = 0; j < 3; ++j)
+        {
+            Joint joint;
+            joint.parent = j - 1;
+            joint.translation = glm::vec3(0.0f, j == 0 ? jointHeights[0] : 1.0f, 0.0f);
+            joint.rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+            joint.inverseBind = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -jointHeights[j], 0.0f));
+            creature.skeleton.joints.push_back(joint);
+        }
+
+        creature.clip.duration = 2.0f;
+        creature.clip.tracks.resize(3);
+        const float amplitude[3] = {0.0f, 0.25f, 0.4f};
+        for (int j = 1; j < 3; ++j)
+        {
+            JointTrack &track = creature.clip.tracks[j];
+            for (int k = 0; k <= 8; ++k)
+            {
+                float t = creature.clip.duration * k / 8.0f;
+                float phase = 6.28318530718f * t / creature.clip.duration - 0.6f * j;
+                glm::quat sway = glm::angleAxis(amplitude[j] * std::sin(phase), glm::vec3(0.0f, 0.0f, 1.0f));
+                glm::quat nod = glm::angleAxis(0.5f * amplitude[j] * std::cos(phase), glm::vec3(1.0f, 0.0f, 0.0f));
+                track.times.push_back(t);
+                track.rotations.push_back(sway * nod);
+            }
+        }
+
+        std::vector<float> vertices;
+        std::vector<GLuint> indices;
+        GenerateSphere(vertices, indices);
+        GLuint srcSize = GeometryArena::GetVertexSize(VertexFormat::Mesh);
+        size_t vertexCount = vertices.size() / srcSize;
+        std::vector<float> skinned;
+        skinned.reserve(vertexCount * GeometryArena::GetVertexSize(VertexFormat::SkinnedMesh));
+        for (size_t i = 0; i < vertexCount; ++i)
+        {
+            const float *v = &vertices[i * srcSize];
+            skinned.insert(skinned.end(), v, v + srcSize);
+            // tent weights along the chain, they sum to one over [-1, 1]
+            float y = v[1];
+            float weights[3];
+            for (int j = 0; j < 3; ++j)
+                weights[j] = std::max(0.0f, 1.0f - std::abs(y - jointHeights[j]));
+            skinned.insert(skinned.end(), {0.0f, 1.0f, 2.0f, 0.0f});
+            skinned.insert(skinned.end(), {weights[0], weights[1], weights[2], 0.0f});
+        }
+        creature.mesh = GeometryArena::Instance().Allocate(VertexFormat::SkinnedMesh, GL_TRIANGLE_STRIP, skinned, indices);
+    }
+    return creature;
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include "geometry.h"
+#include <glm/gtc/quaternion.hpp>
+
+// must match MAX_BONES in the skinned shader permutations
+constexpr int MAX_BONES = 128;
+constexpr GLuint BONE_PALETTE_BINDING = 0;
+
+struct Joint
+{
+    int parent; // -1 for roots, parents always precede their children
+    glm::mat4 inverseBind;
+    glm::vec3 translation;
+    glm::quat rotation;
+};
+
+struct Skeleton
+{
+    std::vector<Joint> joints;
+};
+
+// Keyframes of one joint; an empty track keeps the rest pose of the joint.
+struct JointTrack
+{
+    std::vector<float> times;
+    std::vector<glm::vec3> translations;
+    std::vector<glm::quat> rotations;
+};
+
+struct AnimationClip
+{
+    float duration = 0.0f;
+    std::vector<JointTrack> tracks; // indexed like Skeleton::joints
+};
+
+struct SkinnedInstance
+{
+    const Skeleton *skeleton = nullptr;
+    const AnimationClip *clip = nullptr;
+    float time = 0.0f;
+    std::vector<glm::mat4> skinMatrices; // joint global transform * inverse bind
+};
+
+// Advances and evaluates the pose of every instance on the worker threads.
+void EvaluatePoses(std::vector<SkinnedInstance> &instances, float deltaTime);
+
+// Skin matrices of all instances in one uniform buffer, bound per instance with glBindBufferRange.
+class BonePalette
+{
+private:
+    GLuint m_ubo = 0;
+    GLsizeiptr m_capacity = 0;
+    GLsizeiptr m_stride = 0;
+    std::vector<unsigned char> m_staging;
+
+public:
+    void Upload(const std::vector<SkinnedInstance> &instances);
+    void Bind(size_t instance) const;
+    ~BonePalette();
+};
+
+// Sphere bound to a vertical three-joint chain with a looping sway, standing in for an animated creature.
+struct SwayingSphere
+{
+    MeshHandle mesh;
+    Skeleton skeleton;
+    AnimationClip clip;
+};
+const SwayingSphere &GetSwayingSphere();
@@ -8,23 +8,32 @@
 #include <vector>
 #include <iostream>
 #include <string>
+#include <map>
+#include <memory>
 
 class GLShader
 {
-private:
+protected:
     std::string GLSL;
+    std::string mDefines;
     GLuint mProgram;
     void AttachGLSL(std::string glsl_file_path, GLenum type);
+    // for derived programs that attach their own stages
+    GLShader() : mProgram(glCreateProgram()) {}
 
 public:
-    GLShader(std::string glsl_file_path, bool load_geometry = false);
+    // defines are inserted right after the #version line of every stage, e.g. "#define SKINNED\n". The vertex stage
+    // comes from vertex_file_path + ".vs" when given, so passes can share one, e.g. the full-screen quad.
+    GLShader(std::string glsl_file_path, bool load_geometry = false, std::string defines = "", std::string vertex_file_path = "");
     GLuint GetShaderProgram();
     void SetUniform(const std::string &name, int value);
     void SetUniform(const std::string &name, float value);
     void SetUniform(const std::string &name, bool value);
     void SetUniform(const std::string &name, glm::mat4 mat4);
     void SetUniform(const std::string &name, glm::mat3 mat3);
+    void SetUniform(const std::string &name, glm::vec2 vec2);
     void SetUniform(const std::string &name, glm::vec3 vec3);
+    void SetUniformBlock(const std::string &name, GLuint binding);
     void Use()
     {
         glUseProgram(mProgram);
@@ -32,6 +41,35 @@ public:
     ~GLShader();
 };
 
+// Compute program built from glsl_file_path + ".cs", needs a GL 4.3 context (GLCapabilities::computeShaders).
+class GLComputeShader : public GLShader
+{
+public:
+    GLComputeShader(std::string glsl_file_path, std::string defines = "");
+    void Dispatch(GLuint groupsX, GLuint groupsY, GLuint groupsZ = 1);
+};
+
+// Permutations of one shader, compiled on first use and keyed by their defines.
+class GLShaderPermutations
+{
+private:
+    std::string m_path;
+    std::string m_vertexPath;
+    std::map<std::string, std::unique_ptr<GLShader>> m_shaders;
+    std::map<std::string, std::unique_ptr<GLComputeShader>> m_computeShaders;
+    std::vector<std::pair<std::string, GLuint>> m_uniformBlocks;
+
+public:
+    // vertex_file_path as for GLShader
+    explicit GLShaderPermutations(std::string glsl_file_path, std::string vertex_file_path = "")
+        : m_path(std::move(glsl_file_path)), m_vertexPath(std::move(vertex_file_path)) {}
+    GLShader &Get(const std::string &defines = "");
+    // permutations of the compute shader glsl_file_path.cs
+    GLComputeShader &GetCompute(const std::string &defines = "");
+    // applied to every permutation, including the ones compiled later
+    void SetUniformBlock(const std::string &name, GLuint binding);
+};
+
 
 enum class CameraMovement
 {
@@ -65,6 +103,9 @@ private:
     float m_speed;
     float m_mouseSensitivity;
     float m_zoom;
+    // view-projection of the current and the previous frame, for temporal reprojection
+    glm::mat4 m_viewProjection = glm::mat4(1.0f);
+    glm::mat4 m_previousViewProjection = glm::mat4(1.0f);
     // calculates the front vector from the Camera's (updated) Euler Angles
     void UpdateCameraVectors()
     {
@@ -105,6 +146,16 @@ public:
     {
         return m_zoom;
     }
+    // call once per frame with the frame's view-projection; the previous one then stays available for reprojection
+    void AdvanceFrame(const glm::mat4 &viewProjection)
+    {
+        m_previousViewProjection = m_viewProjection;
+        m_viewProjection = viewProjection;
+    }
+    glm::mat4 GetPreviousViewProjection()
+    {
+        return m_previousViewProjection;
+    }
     // processes input received from any keyboard-like input system. Accepts input parameter in the form of camera defined ENUM (to abstract it from windowing systems)
     void ProcessDirection(CameraMovement direction, float deltaTime)
     {
@@ -156,7 +207,4 @@ public:
 
 int GlfwGladInitialization(GLFWwindow **window, int SRC_WIDTH, int SRC_HEIGHT, const char *title);
 void FramebufferSizeCallback(GLFWwindow *window, int width, int height);
-GLuint LoadTexture(const char *file_path, GLint mode = GL_REPEAT, bool gamma = false);
-
-void RenderSphere();
-void RenderQuad();
\ No newline at end of file
+GLuint LoadTexture(const char *file_path, GLint mode = GL_REPEAT, bool gamma = false);
\ No newline at end of file